@@ -0,0 +1,175 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+
+#include "constants.h"
+#include "chunks.h"
+
+//status of the controller thread
+int status_controller;
+
+//controller thread identification
+static pthread_t tIdController;
+
+//bounds of the number of active workers
+static int min_active, max_active;
+
+//current number of active workers
+static int num_active;
+
+//number of grow and park decisions taken by the controller
+static int num_grows, num_parks;
+
+//highest number of workers active at the same time
+static int peak_active;
+
+//controller life cycle routine
+static void *controller(void *par);
+
+//Read the cgroup CPU quota, returns 0 if there is none
+static int cgroupCpuQuota(void) {
+    FILE * file_pointer;
+    long long quota, period;
+    char max[16];
+
+    //cgroup v2: "<quota> <period>" or "max <period>"
+    if ((file_pointer = fopen("/sys/fs/cgroup/cpu.max", "r")) != NULL) {
+        int n = fscanf(file_pointer, "%15s %lld", max, &period);
+        fclose(file_pointer);
+        if (n == 2 && sscanf(max, "%lld", &quota) == 1 && quota > 0 && period > 0)
+            return (int) ((quota + period - 1) / period);
+        return 0;
+    }
+
+    //cgroup v1: quota is -1 when there is no limit
+    if ((file_pointer = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r")) == NULL)
+        return 0;
+    int n = fscanf(file_pointer, "%lld", &quota);
+    fclose(file_pointer);
+    if (n != 1 || quota <= 0)
+        return 0;
+
+    if ((file_pointer = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r")) == NULL)
+        return 0;
+    n = fscanf(file_pointer, "%lld", &period);
+    fclose(file_pointer);
+    if (n != 1 || period <= 0)
+        return 0;
+
+    return (int) ((quota + period - 1) / period);
+}
+
+//Get the number of CPUs available to the process
+int availableCpus(void) {
+    int num_cpus;
+    cpu_set_t cpu_set;
+
+    //CPUs the process is allowed to run on
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+        num_cpus = CPU_COUNT(&cpu_set);
+    else
+        num_cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+    //a cgroup quota may allow less CPUs than the affinity mask
+    int quota = cgroupCpuQuota();
+    if (quota > 0 && quota < num_cpus)
+        num_cpus = quota;
+
+    return (num_cpus > 0) ? num_cpus : 1;
+}
+
+//Launch the controller thread, performed by the main thread
+void startController(int min_workers, int max_workers) {
+    min_active = min_workers;
+    max_active = max_workers;
+
+    //start with one worker per available CPU, within the configured bounds
+    num_active = availableCpus();
+    if (num_active < min_active) num_active = min_active;
+    if (num_active > max_active) num_active = max_active;
+    peak_active = num_active;
+    num_grows = 0;
+    num_parks = 0;
+
+    setActiveWorkers(num_active);
+
+    if (pthread_create (&tIdController, NULL, controller, NULL) != 0)
+    {
+        perror ("error on creating controller thread");
+        exit (EXIT_FAILURE);
+    }
+}
+
+//Wait for the controller thread, performed by the main thread
+void stopController(void) {
+    int *thread_status;
+
+    if (pthread_join (tIdController, (void *) &thread_status) != 0)
+    {
+        perror ("Error on waiting for thread controller");
+        exit (EXIT_FAILURE);
+    }
+
+    printf ("Adaptive worker count: %d active at the end (bounds %d..%d, peak %d), %d grow and %d park decisions\n",
+            num_active, min_active, max_active, peak_active, num_grows, num_parks);
+}
+
+//its role is to sample the FIFO occupancy and the workers idle time, and grow or park workers accordingly
+static void *controller(void *par) {
+    unsigned int occupancy;
+    unsigned long long idle_ns, last_idle_ns;
+    bool closed;
+    unsigned int occupancy_sum = 0;
+    int num_samples = 0;
+    struct timespec window_start, now;
+
+    //the controller has no arguments, its state is in the statics of this file
+    (void) par;
+
+    getFifoStats(&occupancy, &last_idle_ns, &closed);
+    clock_gettime(CLOCK_MONOTONIC, &window_start);
+
+    while (!closed) {
+        usleep(SAMPLE_PERIOD_US);
+
+        getFifoStats(&occupancy, &idle_ns, &closed);
+        occupancy_sum += occupancy;
+        num_samples++;
+
+        if (num_samples < SAMPLES_PER_DECISION) continue;
+
+        //fraction of the window the active workers spent waiting for chunks
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double window_ns = (now.tv_sec - window_start.tv_sec) * 1000000000.0 + (now.tv_nsec - window_start.tv_nsec);
+        double idle_fraction = (idle_ns - last_idle_ns) / (window_ns * num_active);
+        double mean_occupancy = (double) occupancy_sum / num_samples;
+
+        if (mean_occupancy >= K - 1 && idle_fraction < IDLE_LOW_WATERMARK && num_active < max_active) {
+            //the producer is ahead of the workers: the FIFO stays full and nobody waits
+            num_active++;
+            num_grows++;
+            if (num_active > peak_active) peak_active = num_active;
+            setActiveWorkers(num_active);
+        } else if (mean_occupancy < 1 && idle_fraction > IDLE_HIGH_WATERMARK && num_active > min_active) {
+            //the workers are ahead of the producer: the FIFO stays empty and workers wait
+            num_active--;
+            num_parks++;
+            setActiveWorkers(num_active);
+        }
+
+        last_idle_ns = idle_ns;
+        window_start = now;
+        occupancy_sum = 0;
+        num_samples = 0;
+    }
+
+    status_controller = EXIT_SUCCESS;
+    pthread_exit (&status_controller);
+}
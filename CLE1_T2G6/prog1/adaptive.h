@@ -0,0 +1,31 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+/**
+ *  \brief Get the number of CPUs available to the process.
+ *
+ *  Takes into account the CPU affinity mask and, when present, the cgroup (v1 or v2) CPU quota.
+ *
+ *  \return number of available CPUs (at least 1)
+ */
+extern int availableCpus (void);
+
+/**
+ *  \brief Launch the controller thread that grows or parks workers according to the FIFO occupancy.
+ *
+ *  Operation carried out by the main thread.
+ *
+ *  \param min_workers minimum number of active workers
+ *  \param max_workers maximum number of active workers
+ */
+extern void startController (int min_workers, int max_workers);
+
+/**
+ *  \brief Wait for the termination of the controller thread and print its statistics.
+ *
+ *  Operation carried out by the main thread, after all the chunks have been stored.
+ *
+ */
+extern void stopController (void);
+
+#endif /* ADAPTIVE_H */
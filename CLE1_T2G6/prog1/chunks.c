@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <errno.h>
+#include <time.h>
 
 #include "constants.h"
 
@@ -20,6 +21,9 @@ extern int status_main_producer;
 //workers threads returns status array
 extern int *status_workers;
 
+//status of the controller thread
+extern int status_controller;
+
 //storage region for chunks
 static struct ChunkInfo cmem[K];
 
@@ -30,6 +34,15 @@ static unsigned int retrieval_pointer;
 //flag to check if the transfer region is full
 static bool transfer_region_full;
 
+//number of workers allowed to retrieve chunks
+static unsigned int active_workers;
+
+//flag to check if the main thread has stored the end of chunks marks
+static bool producer_done;
+
+//accumulated time the workers spent waiting in fifo_empty (in nanoseconds)
+static unsigned long long idle_ns;
+
 //locking flag which warrants mutual exclusion inside the monitor
 static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;
 
@@ -42,15 +55,21 @@ static pthread_cond_t fifo_full;
 //workers synchronization point when the data transfer region is empty
 static pthread_cond_t fifo_empty;
 
+//synchronization point of the workers parked by the controller
+static pthread_cond_t worker_parked;
+
 //Initialization of the data transfer region, performed by the monitor
 static void initialization (void)
 {
     insertion_pointer = 0;
     retrieval_pointer = 0;
     transfer_region_full = false;
+    producer_done = false;
+    idle_ns = 0;
 
     pthread_cond_init (&fifo_full, NULL);
     pthread_cond_init (&fifo_empty, NULL);
+    pthread_cond_init (&worker_parked, NULL);
 }
 
 //Store a struct in fifo to inform that there are no more chunks to be processed, performed by the main thread
@@ -74,6 +93,18 @@ void endChunk() {
         }
     }
 
+    //parked workers must wake up to retrieve their end of chunks mark
+    if (!producer_done) {
+        producer_done = true;
+        if ((status_main_producer = pthread_cond_broadcast (&worker_parked)) != 0)
+        {
+            errno = status_main_producer;
+            perror ("error on broadcasting in workerParked");
+            status_main_producer = EXIT_FAILURE;
+            pthread_exit (&status_main_producer);
+        }
+    }
+
     //store values in the FIFO
     cmem[insertion_pointer].file_id = -1;
     cmem[insertion_pointer].chunk_size = -1;
@@ -166,18 +197,39 @@ struct ChunkInfo getChunk (unsigned int worker_id)
 
     pthread_once (&init, initialization);
 
-    //wait if the data transfer region is empty
-    while ((insertion_pointer == retrieval_pointer) && !transfer_region_full)
-    { 
-        if ((status_workers[worker_id] = pthread_cond_wait (&fifo_empty, &accessCR)) != 0)
-        { 
+    //wait while the worker is parked by the controller
+    while ((worker_id >= active_workers) && !producer_done)
+    {
+        if ((status_workers[worker_id] = pthread_cond_wait (&worker_parked, &accessCR)) != 0)
+        {
             errno = status_workers[worker_id];
-            perror ("error on waiting in fifoEmpty");
+            perror ("error on waiting in workerParked");
             status_workers[worker_id] = EXIT_FAILURE;
             pthread_exit (&status_workers[worker_id]);
         }
     }
 
+    //wait if the data transfer region is empty, accounting the time spent waiting
+    if ((insertion_pointer == retrieval_pointer) && !transfer_region_full)
+    {
+        struct timespec wait_start, wait_end;
+        clock_gettime (CLOCK_MONOTONIC, &wait_start);
+
+        while ((insertion_pointer == retrieval_pointer) && !transfer_region_full)
+        { 
+            if ((status_workers[worker_id] = pthread_cond_wait (&fifo_empty, &accessCR)) != 0)
+            { 
+                errno = status_workers[worker_id];
+                perror ("error on waiting in fifoEmpty");
+                status_workers[worker_id] = EXIT_FAILURE;
+                pthread_exit (&status_workers[worker_id]);
+            }
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &wait_end);
+        idle_ns += (wait_end.tv_sec - wait_start.tv_sec) * 1000000000ULL + wait_end.tv_nsec - wait_start.tv_nsec;
+    }
+
     //retrieve a  value from the FIFO
     chunk_info = cmem[retrieval_pointer];
     retrieval_pointer = (retrieval_pointer + 1) % K;
@@ -202,4 +254,67 @@ struct ChunkInfo getChunk (unsigned int worker_id)
     }
 
     return chunk_info;
+}
+
+//Set the number of workers allowed to retrieve chunks, performed by the main thread and by the controller
+void setActiveWorkers (unsigned int n_workers)
+{
+    //entering monitor
+    if ((status_controller = pthread_mutex_lock (&accessCR)) != 0)
+    {
+        errno = status_controller;
+        perror ("error on entering monitor(CF)");
+        status_controller = EXIT_FAILURE;
+        pthread_exit (&status_controller);
+    }
+
+    pthread_once (&init, initialization);
+
+    active_workers = n_workers;
+
+    //let the parked workers check if they may resume
+    if ((status_controller = pthread_cond_broadcast (&worker_parked)) != 0)
+    {
+        errno = status_controller;
+        perror ("error on broadcasting in workerParked");
+        status_controller = EXIT_FAILURE;
+        pthread_exit (&status_controller);
+    }
+
+    //exiting monitor
+    if ((status_controller = pthread_mutex_unlock (&accessCR)) != 0)
+    {
+        errno = status_controller;
+        perror ("error on exiting monitor(CF)");
+        status_controller = EXIT_FAILURE;
+        pthread_exit (&status_controller);
+    }
+}
+
+//Get the current state of the data transfer region, performed by the controller
+void getFifoStats (unsigned int * occupancy, unsigned long long * idle, bool * closed)
+{
+    //entering monitor
+    if ((status_controller = pthread_mutex_lock (&accessCR)) != 0)
+    {
+        errno = status_controller;
+        perror ("error on entering monitor(CF)");
+        status_controller = EXIT_FAILURE;
+        pthread_exit (&status_controller);
+    }
+
+    pthread_once (&init, initialization);
+
+    *occupancy = transfer_region_full ? K : (insertion_pointer + K - retrieval_pointer) % K;
+    *idle = idle_ns;
+    *closed = producer_done;
+
+    //exiting monitor
+    if ((status_controller = pthread_mutex_unlock (&accessCR)) != 0)
+    {
+        errno = status_controller;
+        perror ("error on exiting monitor(CF)");
+        status_controller = EXIT_FAILURE;
+        pthread_exit (&status_controller);
+    }
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef CHUNKS_H
 #define CHUNKS_H
 
+#include <stdbool.h>
+
 /**
  *  \brief Store a struct to inform that there are no more chunks to be processed.
  *
@@ -32,6 +34,29 @@ extern void putChunk (unsigned char * buffer, unsigned int chunk_size, unsigned
  */
 extern struct ChunkInfo getChunk (unsigned int worker_id);
 
+/**
+ *  \brief Set the number of workers allowed to retrieve chunks.
+ *
+ *  Workers whose identification is equal or higher than this value are parked until it grows again
+ *  or until there are no more chunks to be stored.
+ *
+ *  Operation carried out by the main thread and by the controller.
+ *
+ *  \param n_workers number of active workers
+ */
+extern void setActiveWorkers (unsigned int n_workers);
+
+/**
+ *  \brief Get the current state of the data transfer region.
+ *
+ *  Operation carried out by the controller.
+ *
+ *  \param occupancy number of chunks currently stored in the FIFO
+ *  \param idle_ns accumulated time (in nanoseconds) the workers spent waiting for chunks
+ *  \param closed true if the main thread has already stored the end of chunks marks
+ */
+extern void getFifoStats (unsigned int * occupancy, unsigned long long * idle_ns, bool * closed);
+
 /** \brief struct to store the information of one chunk*/
 extern struct ChunkInfo {
    int file_id;        /* file identifier */  
@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zstd.h>
+#endif
+
+#include "constants.h"
+#include "chunks.h"
+#include "cutIndex.h"
+#include "compressed.h"
+
+//struct used to store the decompressed bytes that were not put in chunks yet
+struct Pending {
+    unsigned char *data;
+    long size;
+    long capacity;
+};
+
+//Check if a string ends with a suffix
+static bool hasSuffix(char *name, char *suffix) {
+    size_t name_length = strlen(name), suffix_length = strlen(suffix);
+    return name_length >= suffix_length && strcmp(name + name_length - suffix_length, suffix) == 0;
+}
+
+//Check if a file is compressed
+bool isCompressed(char *file_name) {
+    return hasSuffix(file_name, ".gz") || hasSuffix(file_name, ".zst");
+}
+
+//Append decompressed bytes to the pending ones
+static void appendPending(struct Pending *pending, unsigned char *bytes, long num_bytes) {
+    if (pending->size + num_bytes > pending->capacity) {
+        if (pending->capacity == 0) pending->capacity = num_bytes;
+        while (pending->size + num_bytes > pending->capacity) pending->capacity *= 2;
+        pending->data = realloc(pending->data, pending->capacity);
+    }
+    memcpy(pending->data + pending->size, bytes, num_bytes);
+    pending->size += num_bytes;
+}
+
+//Put in FIFO every pending chunk whose end is already known, or all of them at the end of the file
+static int flushChunks(struct Pending *pending, int file_id, int chunk_size, bool end_of_file) {
+    long start = 0;
+    int num_of_chunks = 0;
+
+    while (start < pending->size) {
+        long current_chunk_size;
+        int current_char_size = 0;
+
+        if (start + chunk_size > pending->size) {
+            //the end of the chunk is only known when more data is decompressed, unless it is the last chunk
+            if (!end_of_file) break;
+            current_chunk_size = pending->size - start;
+        } else {
+            //the chunk is cut as in an uncompressed file, if the safe-cut character was already decompressed
+            current_chunk_size = nextSafeCutInBuffer(pending->data, start + chunk_size, pending->size, &current_char_size) - start;
+            if (current_char_size == 0 && !end_of_file) break;
+        }
+
+        //the chunk includes the character where it was cut
+        unsigned char *buffer = malloc(current_chunk_size + current_char_size);
+        memcpy(buffer, pending->data + start, current_chunk_size + current_char_size);
+        putChunk(buffer, current_chunk_size + current_char_size, file_id);
+        num_of_chunks++;
+
+        start += current_chunk_size;
+    }
+
+    //keep the bytes of the chunk not put in FIFO
+    memmove(pending->data, pending->data + start, pending->size - start);
+    pending->size -= start;
+
+    return num_of_chunks;
+}
+
+//Decompress a gzip file block by block
+static int produceGzChunks(char *file_name, int file_id, int chunk_size) {
+    struct Pending pending = { NULL, 0, 0 };
+    int num_of_chunks = 0;
+    int num_read;
+
+    gzFile gz_file = gzopen(file_name, "rb");
+    if (gz_file == NULL) {
+        printf("It occoured an error while openning file: %s \n", file_name);
+        exit(EXIT_FAILURE);
+    }
+    gzbuffer(gz_file, GZ_BLOCK_SIZE);
+
+    unsigned char *block = malloc(GZ_BLOCK_SIZE);
+    while ((num_read = gzread(gz_file, block, GZ_BLOCK_SIZE)) > 0) {
+        appendPending(&pending, block, num_read);
+        num_of_chunks += flushChunks(&pending, file_id, chunk_size, false);
+    }
+
+    if (num_read < 0) {
+        int error;
+        fprintf(stderr, "Error decompressing file %s: %s\n", file_name, gzerror(gz_file, &error));
+        exit(EXIT_FAILURE);
+    }
+
+    num_of_chunks += flushChunks(&pending, file_id, chunk_size, true);
+
+    gzclose(gz_file);
+    free(block);
+    free(pending.data);
+
+    return num_of_chunks;
+}
+
+#ifdef HAVE_ZSTD
+
+//struct used to store one frame of a zstd file
+struct Frame {
+    const unsigned char *compressed;    //start of the compressed frame
+    size_t compressed_size;
+    unsigned char *data;                //decompressed frame
+    size_t size;
+    bool ready;                         //the frame was decompressed
+};
+
+//frames of the file being decompressed
+static struct Frame *frames;
+
+//number of frames of the file
+static int num_of_frames;
+
+//next frame to be decompressed
+static int next_frame;
+
+//next frame to be split in chunks
+static int next_consumed;
+
+//number of frames that may be decompressed ahead of the one being split
+static int frames_ahead;
+
+//name of the file being decompressed
+static char *zstd_file_name;
+
+//locking flag which warrants mutual exclusion on the frames
+static pthread_mutex_t accessFrames = PTHREAD_MUTEX_INITIALIZER;
+
+//main synchronization point while the next frame is being decompressed
+static pthread_cond_t frame_ready = PTHREAD_COND_INITIALIZER;
+
+//decompression threads synchronization point while they are too far ahead
+static pthread_cond_t frame_consumed = PTHREAD_COND_INITIALIZER;
+
+//Exit after a zstd error
+static void zstdError(size_t code) {
+    fprintf(stderr, "Error decompressing file %s: %s\n", zstd_file_name, ZSTD_getErrorName(code));
+    exit(EXIT_FAILURE);
+}
+
+//Decompress data with the streaming API, calling flush after each output block
+static void decompressStream(ZSTD_DCtx *context, const unsigned char *src, size_t src_size, struct Pending *output,
+                             int file_id, int chunk_size, int *num_of_chunks) {
+    ZSTD_inBuffer input = { src, src_size, 0 };
+    size_t block_size = ZSTD_DStreamOutSize();
+    unsigned char *block = malloc(block_size);
+
+    while (input.pos < input.size) {
+        ZSTD_outBuffer out = { block, block_size, 0 };
+        size_t ret = ZSTD_decompressStream(context, &out, &input);
+        if (ZSTD_isError(ret)) zstdError(ret);
+
+        appendPending(output, block, out.pos);
+        if (num_of_chunks != NULL)
+            *num_of_chunks += flushChunks(output, file_id, chunk_size, false);
+    }
+
+    free(block);
+}
+
+//its role is to decompress frames, in order, up to frames_ahead frames ahead of the one being split
+static void *decompressor(void *par) {
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+
+    while (true) {
+        pthread_mutex_lock(&accessFrames);
+        while (next_frame < num_of_frames && next_frame >= next_consumed + frames_ahead)
+            pthread_cond_wait(&frame_consumed, &accessFrames);
+        if (next_frame >= num_of_frames) {
+            pthread_mutex_unlock(&accessFrames);
+            break;
+        }
+        struct Frame *frame = &frames[next_frame++];
+        pthread_mutex_unlock(&accessFrames);
+
+        //every frame is independent
+        struct Pending output = { NULL, 0, 0 };
+        ZSTD_DCtx_reset(context, ZSTD_reset_session_only);
+        decompressStream(context, frame->compressed, frame->compressed_size, &output, 0, 0, NULL);
+
+        pthread_mutex_lock(&accessFrames);
+        frame->data = output.data;
+        frame->size = output.size;
+        frame->ready = true;
+        pthread_cond_broadcast(&frame_ready);
+        pthread_mutex_unlock(&accessFrames);
+    }
+
+    ZSTD_freeDCtx(context);
+    return NULL;
+}
+
+//Decompress a zstd file, frame by frame
+static int produceZstdChunks(char *file_name, int file_id, int chunk_size, int num_of_threads) {
+    struct Pending pending = { NULL, 0, 0 };
+    struct stat file_stat;
+    int num_of_chunks = 0;
+
+    zstd_file_name = file_name;
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+        printf("It occoured an error while openning file: %s \n", file_name);
+        exit(EXIT_FAILURE);
+    }
+    if (file_stat.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    const unsigned char *src = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (src == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    madvise((void *) src, file_stat.st_size, MADV_SEQUENTIAL);
+
+    //locate the frames
+    int capacity = 16;
+    frames = malloc(capacity * sizeof(struct Frame));
+    num_of_frames = 0;
+    for (size_t offset = 0; offset < (size_t) file_stat.st_size; ) {
+        size_t frame_size = ZSTD_findFrameCompressedSize(src + offset, file_stat.st_size - offset);
+        if (ZSTD_isError(frame_size)) zstdError(frame_size);
+
+        if (num_of_frames == capacity) {
+            capacity *= 2;
+            frames = realloc(frames, capacity * sizeof(struct Frame));
+        }
+        frames[num_of_frames].compressed = src + offset;
+        frames[num_of_frames].compressed_size = frame_size;
+        frames[num_of_frames].data = NULL;
+        frames[num_of_frames].ready = false;
+        num_of_frames++;
+
+        offset += frame_size;
+    }
+
+    if (num_of_threads > num_of_frames) num_of_threads = num_of_frames;
+
+    if (num_of_threads <= 1) {
+        //a single frame can only be decompressed sequentially, so it is streamed and split as it is decompressed
+        ZSTD_DCtx *context = ZSTD_createDCtx();
+        decompressStream(context, src, file_stat.st_size, &pending, file_id, chunk_size, &num_of_chunks);
+        ZSTD_freeDCtx(context);
+    } else {
+        pthread_t tIdDecompressors[num_of_threads];
+
+        next_frame = 0;
+        next_consumed = 0;
+        frames_ahead = num_of_threads * FRAMES_AHEAD_PER_THREAD;
+
+        for (int i = 0; i < num_of_threads; i++)
+            if (pthread_create(&tIdDecompressors[i], NULL, decompressor, NULL) != 0) {
+                perror("error on creating decompression thread");
+                exit(EXIT_FAILURE);
+            }
+
+        //split the frames in chunks, in order, while the next ones are decompressed
+        for (int f = 0; f < num_of_frames; f++) {
+            pthread_mutex_lock(&accessFrames);
+            while (!frames[f].ready)
+                pthread_cond_wait(&frame_ready, &accessFrames);
+            pthread_mutex_unlock(&accessFrames);
+
+            appendPending(&pending, frames[f].data, frames[f].size);
+            free(frames[f].data);
+            num_of_chunks += flushChunks(&pending, file_id, chunk_size, false);
+
+            pthread_mutex_lock(&accessFrames);
+            next_consumed = f + 1;
+            pthread_cond_broadcast(&frame_consumed);
+            pthread_mutex_unlock(&accessFrames);
+        }
+
+        for (int i = 0; i < num_of_threads; i++)
+            if (pthread_join(tIdDecompressors[i], NULL) != 0) {
+                perror("Error on waiting for decompression thread");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    num_of_chunks += flushChunks(&pending, file_id, chunk_size, true);
+
+    free(frames);
+    free(pending.data);
+    munmap((void *) src, file_stat.st_size);
+    close(fd);
+
+    return num_of_chunks;
+}
+
+#endif /* HAVE_ZSTD */
+
+//Decompress a file and put its chunks in FIFO, performed by the main thread
+int produceCompressedChunks(char *file_name, int file_id, int chunk_size, int num_of_threads) {
+    if (hasSuffix(file_name, ".gz"))
+        return produceGzChunks(file_name, file_id, chunk_size);
+
+#ifdef HAVE_ZSTD
+    return produceZstdChunks(file_name, file_id, chunk_size, num_of_threads);
+#else
+    (void) num_of_threads;
+    fprintf(stderr, "Can't read %s: compiled without zstd support (build with -DHAVE_ZSTD -lzstd)\n", file_name);
+    exit(EXIT_FAILURE);
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef COMPRESSED_H
+#define COMPRESSED_H
+
+#include <stdbool.h>
+
+/**
+ *  \brief Check if a file is compressed, by its name.
+ *
+ *  Files ending in ".gz" are read with zlib; files ending in ".zst" with libzstd (only when the program is
+ *  compiled with HAVE_ZSTD).
+ *
+ *  \param file_name name of the file
+ *
+ *  \return true if the file is compressed
+ */
+extern bool isCompressed (char * file_name);
+
+/**
+ *  \brief Decompress a file and put its chunks in the data transfer region.
+ *
+ *  The decompressed data is split in chunks in memory, with the same safe cut points as an uncompressed file,
+ *  so no temporary file is written and the workers count chunks while the rest of the file is decompressed.
+ *  Multi-frame zstd files are decompressed by several threads, one frame each.
+ *
+ *  Operation carried out by the main thread.
+ *
+ *  \param file_name name of the file
+ *  \param file_id file identifier
+ *  \param chunk_size nominal number of bytes of a chunk
+ *  \param num_of_threads number of decompression threads (multi-frame zstd files only)
+ *
+ *  \return number of chunks put in the data transfer region
+ */
+extern int produceCompressedChunks (char * file_name, int file_id, int chunk_size, int num_of_threads);
+
+#endif /* COMPRESSED_H */
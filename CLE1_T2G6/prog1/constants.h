@@ -9,4 +9,45 @@
 /** \brief data transfer region nominal capacity (in number of values that can be stored) in the FIFO */
 #define  K            10
 
+/* Adaptive worker count parameters */
+
+/** \brief interval between two samples of the FIFO state taken by the controller (in microseconds) */
+#define  SAMPLE_PERIOD_US     2000
+
+/** \brief number of samples the controller averages before deciding to grow or park a worker */
+#define  SAMPLES_PER_DECISION   10
+
+/** \brief fraction of time the active workers may wait for chunks before one of them is parked */
+#define  IDLE_HIGH_WATERMARK   0.5
+
+/** \brief fraction of time the active workers may wait for chunks for a new worker to be added */
+#define  IDLE_LOW_WATERMARK    0.1
+
+/* Chunk boundary index parameters */
+
+/** \brief suffix of the sidecar index of an input file */
+#define  INDEX_SUFFIX      ".cutidx"
+
+/** \brief nominal chunk sizes whose safe cut points are stored in the sidecar index */
+#define  INDEX_GRANULARITIES   { 1000, 4000, 16000, 64000 }
+
+/* Compressed input parameters */
+
+/** \brief number of compressed bytes read at a time from a gzip file */
+#define  GZ_BLOCK_SIZE        65536
+
+/** \brief default number of threads decompressing the frames of a multi-frame zstd file */
+#define  DECOMPRESSION_THREADS     2
+
+/** \brief number of frames that may be decompressed ahead of the one being split in chunks, per decompression thread */
+#define  FRAMES_AHEAD_PER_THREAD   2
+
+/* Estimate mode parameters */
+
+/** \brief minimum number of chunks counted per file before its estimate may be considered precise */
+#define  MIN_SAMPLES           30
+
+/** \brief standard normal quantile of the confidence level of the estimates (95%) */
+#define  Z_CONFIDENCE        1.96
+
 #endif /* PROBCONST_H_ */
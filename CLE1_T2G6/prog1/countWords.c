@@ -7,27 +7,56 @@
 #include <locale.h>
 #include <time.h>
 #include <pthread.h>
+#include <unistd.h>
 
+#include "adaptive.h"
 #include "chunks.h"
+#include "compressed.h"
 #include "constants.h"
 #include "counters.h"
+#include "cutIndex.h"
 #include "countWordsFunctions.h"
 
 //worker life cycle routine
 static void *worker(void *par);
 
-//process a chunk to count its words 
-static void processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants);
+//print the command line usage
+static void printUsage(char *program_name);
+
+//check if a command line argument is a positive number
+static bool isNumber(char *arg);
+
+//read a chunk of a file and put it in FIFO
+static void putFileChunk(FILE *file_pointer, long offset, int size, int file_id);
+
+//generate all the chunks of a file and put them in FIFO
+static void produceChunks(FILE *file_pointer, long file_size, int file_id, bool use_index);
+
+//generate a stratified random sample of the chunks of a file and put them in FIFO until the precision is reached
+static void produceSampledChunks(FILE *file_pointer, long file_size, int file_id, bool use_index, double precision, unsigned int *seed);
+
+//process a chunk to count its words, returns true if it took the ASCII fast path
+static bool processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants);
+
+//process a chunk that has multibyte characters
+static void processMultibyteChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants);
 
 //workers threads returns status array
 int *status_workers;
 
+//number of bytes and chunks processed by each worker in the ASCII fast path and in the multibyte path
+static long long *ascii_bytes, *multibyte_bytes;
+static int *ascii_chunks, *multibyte_chunks;
+
 //status of the main thread
 int status_main_producer;
 
 //number of bytes that a chunk should have
 int num_bytes = N;  
 
+//names of the files to process
+static char **file_names;
+
 
 int main(int argc, char *argv[]) {
 
@@ -35,10 +64,80 @@ int main(int argc, char *argv[]) {
 
     int *thread_status;
 
+    int num_of_threads = 0;     //fixed number of worker threads (0 means one per available CPU)
+    bool adaptive = false;      //grow or park workers according to the FIFO occupancy
+    int min_threads = 0, max_threads = 0;
+    bool estimate = false;      //count only a sample of the chunks and extrapolate the counters
+    double precision = 0;       //relative half-width of the confidence interval required in estimate mode
+    unsigned int seed = (unsigned int) time(NULL) ^ (unsigned int) getpid();
+    bool use_index = false;     //read the chunk boundaries from the sidecar index of each file
+    int num_of_decompressors = DECOMPRESSION_THREADS;      //threads decompressing multi-frame zstd files
+
+    //parse the command line options
+    int opt;
+    while ((opt = getopt(argc, argv, "t:a:e:s:id:h")) != -1) {
+        switch (opt) {
+            case 't':
+                if (!isNumber(optarg) || (num_of_threads = atoi(optarg)) <= 0) {
+                    fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'a':
+                if (sscanf(optarg, "%d:%d", &min_threads, &max_threads) != 2 || min_threads <= 0 || max_threads < min_threads) {
+                    fprintf(stderr, "Invalid adaptive bounds: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                adaptive = true;
+                break;
+            case 'e':
+                if (sscanf(optarg, "%lf", &precision) != 1 || precision <= 0 || precision >= 1) {
+                    fprintf(stderr, "Invalid precision: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                estimate = true;
+                break;
+            case 's':
+                seed = (unsigned int) strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                use_index = true;
+                break;
+            case 'd':
+                if (!isNumber(optarg) || (num_of_decompressors = atoi(optarg)) <= 0) {
+                    fprintf(stderr, "Invalid number of decompression threads: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'h':
+                printUsage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    //the number of threads may also be given as the first positional argument
+    if (num_of_threads == 0 && !adaptive && (argc - optind) > 1 && isNumber(argv[optind])) {
+        num_of_threads = atoi(argv[optind++]);
+    }
+
+    if (optind >= argc) {
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (adaptive) {
+        num_of_threads = max_threads;       //every worker is created, but only the active ones retrieve chunks
+    } else if (num_of_threads == 0) {
+        num_of_threads = availableCpus();
+    }
+
     //save filenames in the shared region and initialize counters to 0
-    char *file_names[argc-2];
-    for(int i=0; i<argc-2; i++) file_names[i] = argv[i+2];
-    storeFileNames(argc-2, file_names);
+    int num_of_files = argc - optind;
+    file_names = &argv[optind];
+    storeFileNames(num_of_files, file_names);
 
     //measure time
     struct timespec start_time, finish_time;
@@ -46,13 +145,22 @@ int main(int argc, char *argv[]) {
     clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
 
     //assign ids to each worker thread
-    int num_of_threads = atoi(argv[1]);     //get the number of threads from the command line first argument
     status_workers = malloc(num_of_threads * sizeof(int));   //allocate memory to save the status of each worker
+    ascii_bytes = calloc(num_of_threads, sizeof(long long));
+    multibyte_bytes = calloc(num_of_threads, sizeof(long long));
+    ascii_chunks = calloc(num_of_threads, sizeof(int));
+    multibyte_chunks = calloc(num_of_threads, sizeof(int));
     pthread_t tIdWorkers[num_of_threads];
     unsigned int workers_id[num_of_threads];
     for (int i = 0; i < num_of_threads; i++)
         workers_id[i] = i;
 
+    //define how many workers may retrieve chunks
+    if (adaptive)
+        startController(min_threads, max_threads);
+    else
+        setActiveWorkers(num_of_threads);
+
     //generate worker threads
     for (int i = 0; i < num_of_threads; i++)
     if (pthread_create (&tIdWorkers[i], NULL, worker, &workers_id[i]) != 0)
@@ -61,87 +169,32 @@ int main(int argc, char *argv[]) {
         exit (EXIT_FAILURE);
     }
 
-    //generate the chunks of each file and put in FIFO
-    for(int i=0;i<argc-2;i++){
+    //generate the chunks of each file (or a sample of them) and put in FIFO
+    for(int i=0;i<num_of_files;i++){
         FILE * file_pointer;
-        unsigned char byte;        //variable used to store each byte of the file  
-        unsigned char *character;  //variable used to store the char
+
+        //compressed files are split as they are decompressed, so they can't be sampled nor indexed
+        if (isCompressed(file_names[i])) {
+            int num_of_chunks = produceCompressedChunks(file_names[i], i, num_bytes, num_of_decompressors);
+            if (estimate)
+                setNumOfChunks(i, num_of_chunks);
+            continue;
+        }
 
         file_pointer = fopen(file_names[i], "r");
         if (file_pointer == NULL) {
-            printf("It occoured an error while openning file: %s \n", argv[i]);
+            printf("It occoured an error while openning file: %s \n", file_names[i]);
             exit(EXIT_FAILURE);
         }
 
         //get file size
         fseek(file_pointer, 0, SEEK_END);
-        int file_size = ftell(file_pointer);
-
-        //seek file to the start
-        fseek(file_pointer, 0, SEEK_SET);
-        int bytes_processed = 0;
-        int current_chunk_size;
-
-        //while there are still bytes to create a chunk 
-        while (bytes_processed < file_size) {
-
-            int current_char_size = 0; //number of bytes read for the current char (it can be single byte or multibyte)
-
-            //if it is the last chunk of the file
-            if ( (bytes_processed + num_bytes) > file_size ) {
-                //size of current chunk will be the remaining bytes
-                current_chunk_size = file_size - bytes_processed;
-            } else {
-                current_chunk_size = num_bytes;  //chunk will have the default size of chunk
-                fseek(file_pointer, bytes_processed + current_chunk_size, SEEK_SET);       // Seek file to the end of chunk
-
-                //update the size of the chunk to ensure it doesn't cut a word or multibyte character
-                while (true) {                  
-                    byte = fgetc(file_pointer);
-
-                    current_char_size = 1;  
-                    character = malloc((1+1)* sizeof(unsigned char) );      //the last byte of the character is required to be 0
-                    character[0] = byte;
-
-                    //determine if the byte represents a 3-byte character or a single byte character
-                    //safe-cut characters include whitespace (single byte), separation(single or multibyte), and punctuation(single or multibyte)
-                    if ( byte > 224 && byte < 240) {     // 3-byte char
-                        // Create the 3-byte character
-                        character = realloc(character, (3+1)* sizeof(unsigned char) );      //reallocate memory to accomodate a 3-byte character
-                        byte = fgetc(file_pointer);    //read another byte
-                        character[1] = byte;
-                        byte = fgetc(file_pointer);    //read another byte
-                        character[2] = byte;
-                        character[3] = 0;
-                        current_char_size += 2;
-                    } else {                        //it's a single byte char
-                        character[1] = 0;
-                    }
-
-                    //if it is a safe place to cut the chunk, so we break
-                    if (is_whitespace(character) || is_separation(character) || is_punctuation(character)) {
-                        break;
-                    }
-
-                    //increment the size of chunk
-                    current_chunk_size += current_char_size;
-                }
-            }
-
-            //seek file to the initial of the chunk
-            fseek(file_pointer, bytes_processed, SEEK_SET);
-
-            //create buffer for the chunk with the current chunk + the last character
-            unsigned char* buffer = malloc(current_chunk_size + current_char_size);
-            int s = fread(buffer, current_chunk_size + current_char_size, 1, file_pointer);
-            if (s != 1)
-                printf("Error creating chunk buffer.");
-
-            //save chunk in FIFO
-            putChunk(buffer, current_chunk_size + current_char_size, i);
+        long file_size = ftell(file_pointer);
 
-            bytes_processed += current_chunk_size;
-        }
+        if (estimate)
+            produceSampledChunks(file_pointer, file_size, i, use_index, precision, &seed);
+        else
+            produceChunks(file_pointer, file_size, i, use_index);
 
         //close file
         fclose(file_pointer);
@@ -152,6 +205,9 @@ int main(int argc, char *argv[]) {
         endChunk();
     }
 
+    if (adaptive)
+        stopController();
+
    //waiting for the termination of the intervening worker threads
     for (int i = 0; i < num_of_threads; i++)
     { 
@@ -169,10 +225,136 @@ int main(int argc, char *argv[]) {
     elapsed_time += (finish_time.tv_nsec - start_time.tv_nsec) / 1000000000.0;
 
     //print final results
-    printResults();
+    if (estimate)
+        printEstimates();
+    else
+        printResults();
+
+    //fraction of the bytes that took each path
+    long long total_ascii_bytes = 0, total_multibyte_bytes = 0;
+    int total_ascii_chunks = 0, total_multibyte_chunks = 0;
+    for (int i = 0; i < num_of_threads; i++) {
+        total_ascii_bytes += ascii_bytes[i];
+        total_multibyte_bytes += multibyte_bytes[i];
+        total_ascii_chunks += ascii_chunks[i];
+        total_multibyte_chunks += multibyte_chunks[i];
+    }
+    if (total_ascii_bytes + total_multibyte_bytes > 0)
+        printf("\nASCII fast path: %.1f%% of bytes (%d chunks), multibyte path: %.1f%% of bytes (%d chunks)\n",
+               100.0 * total_ascii_bytes / (total_ascii_bytes + total_multibyte_bytes), total_ascii_chunks,
+               100.0 * total_multibyte_bytes / (total_ascii_bytes + total_multibyte_bytes), total_multibyte_chunks);
+
     printf("\nElapsed time = %.7f s\n", elapsed_time);
 }
 
+static void printUsage(char *program_name) {
+    fprintf(stderr, "Usage: %s [-t threads | -a min:max] [-e precision [-s seed]] [-i] [-d threads] file...\n"
+                    "       %s threads file...\n"
+                    "  -t threads   fixed number of worker threads (default: number of available CPUs)\n"
+                    "  -a min:max   adaptive number of worker threads, grown or parked within the bounds\n"
+                    "               according to the FIFO occupancy and the workers idle time\n"
+                    "  -e precision estimate mode: count a stratified random sample of the chunks until the\n"
+                    "               95%% confidence interval is within +/- precision (e.g. 0.02) of the estimate\n"
+                    "  -s seed      seed of the random sample (default: based on the time)\n"
+                    "  -i           read the chunk boundaries from the sidecar index of each file (file" INDEX_SUFFIX "),\n"
+                    "               building it when it is missing or older than the file\n"
+                    "  -d threads   number of threads decompressing multi-frame .zst files (default: %d);\n"
+                    "               .gz and .zst files are always counted in full, without an index\n",
+                    program_name, program_name, DECOMPRESSION_THREADS);
+}
+
+static bool isNumber(char *arg) {
+    if (*arg == '\0') return false;
+    for (; *arg != '\0'; arg++)
+        if (!isdigit((unsigned char) *arg)) return false;
+    return true;
+}
+
+static void putFileChunk(FILE *file_pointer, long offset, int size, int file_id) {
+    //seek file to the initial of the chunk
+    fseek(file_pointer, offset, SEEK_SET);
+
+    unsigned char* buffer = malloc(size);
+    if (size > 0 && fread(buffer, size, 1, file_pointer) != 1)
+        printf("Error creating chunk buffer.");
+
+    //save chunk in FIFO
+    putChunk(buffer, size, file_id);
+}
+
+static void produceChunks(FILE *file_pointer, long file_size, int file_id, bool use_index) {
+    int num_of_chunks;
+    struct ChunkBounds *chunks = getChunkBounds(file_names[file_id], file_pointer, file_size, num_bytes, use_index, &num_of_chunks);
+
+    for (int k = 0; k < num_of_chunks; k++)
+        putFileChunk(file_pointer, chunks[k].offset, chunks[k].size, file_id);
+
+    free(chunks);
+}
+
+static void produceSampledChunks(FILE *file_pointer, long file_size, int file_id, bool use_index, double precision, unsigned int *seed) {
+    //with an index the strata are the indexed chunks (the index is built by the first run, which scans the whole file);
+    //otherwise stratum s spans from the first safe cut after s*N to the first safe cut after (s+1)*N, so the strata
+    //partition the file without scanning all of it
+    int num_of_strata = (file_size + num_bytes - 1) / num_bytes;
+    struct ChunkBounds *chunks = use_index ? getChunkBounds(file_names[file_id], file_pointer, file_size, num_bytes, true, &num_of_strata)
+                                           : NULL;
+    setNumOfChunks(file_id, num_of_strata);
+    if (num_of_strata == 0) {
+        free(chunks);
+        return;
+    }
+
+    //the strata are grouped in bands of consecutive strata, whose size is about the square root of their number
+    int band_size = 1;
+    while (band_size * band_size < num_of_strata) band_size++;
+
+    //shuffle each band
+    int *strata = malloc(num_of_strata * sizeof(int));
+    for (int s = 0; s < num_of_strata; s++) strata[s] = s;
+    for (int band_start = 0; band_start < num_of_strata; band_start += band_size) {
+        int band_end = (band_start + band_size < num_of_strata) ? band_start + band_size : num_of_strata;
+        for (int s = band_end - 1; s > band_start; s--) {
+            int r = band_start + rand_r(seed) % (s - band_start + 1);
+            int tmp = strata[s];
+            strata[s] = strata[r];
+            strata[r] = tmp;
+        }
+    }
+
+    //each round takes one stratum of every band, so any prefix of the sample covers the whole file
+    int *order = malloc(num_of_strata * sizeof(int));
+    int num_ordered = 0;
+    for (int round = 0; round < band_size; round++)
+        for (int band_start = 0; band_start < num_of_strata; band_start += band_size)
+            if (band_start + round < num_of_strata)
+                order[num_ordered++] = strata[band_start + round];
+
+    for (int k = 0; k < num_of_strata; k++) {
+        int s = order[k];
+
+        if (chunks != NULL) {
+            putFileChunk(file_pointer, chunks[s].offset, chunks[s].size, file_id);
+        } else {
+            int char_size = 0, start_char_size;
+            long start = (s == 0) ? 0 : nextSafeCut(file_pointer, (long) s * num_bytes, file_size, &start_char_size);
+            long end = file_size;
+            if ((long) (s + 1) * num_bytes < file_size)
+                end = nextSafeCut(file_pointer, (long) (s + 1) * num_bytes, file_size, &char_size);
+
+            //a stratum without safe cuts inside is a single character that holds no words
+            putFileChunk(file_pointer, start, end - start + char_size, file_id);
+        }
+
+        //stop once the results already counted are precise enough
+        if (estimateReached(file_id, precision)) break;
+    }
+
+    free(order);
+    free(strata);
+    free(chunks);
+}
+
 //its role is to get chunks of data and count the words. After that, it incrementes the counters in shared region.
 static void *worker(void *par) {
     unsigned int id = *((unsigned int *) par);
@@ -187,7 +369,13 @@ static void *worker(void *par) {
         //process chunk of data
         int total_num_of_words = 0;
         int total_words_with_two_equal_consonants = 0;
-        processChunk(&chunk_info, &total_num_of_words, &total_words_with_two_equal_consonants);
+        if (processChunk(&chunk_info, &total_num_of_words, &total_words_with_two_equal_consonants)) {
+            ascii_bytes[id] += chunk_info.chunk_size;
+            ascii_chunks[id] += 1;
+        } else {
+            multibyte_bytes[id] += chunk_info.chunk_size;
+            multibyte_chunks[id] += 1;
+        }
 
         //free the memory of the buffer
         free(chunk_info.chunk_pointer);
@@ -200,7 +388,18 @@ static void *worker(void *par) {
     pthread_exit (&status_workers[id]);
 }
 
-static void processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants) {
+static bool processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants) {
+    //chunks without bytes above 0x7F don't need the multibyte checks
+    if (is_ascii((*chunk_info).chunk_pointer, (*chunk_info).chunk_size)) {
+        count_words_ascii((*chunk_info).chunk_pointer, (*chunk_info).chunk_size, total_num_of_words, total_words_with_two_equal_consonants);
+        return true;
+    }
+
+    processMultibyteChunk(chunk_info, total_num_of_words, total_words_with_two_equal_consonants);
+    return false;
+}
+
+static void processMultibyteChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants) {
     //flag used to determine if the algorithm is handling the char inside a word context or not
     bool inword = false;  
 
@@ -5,6 +5,12 @@
 #include <stdbool.h>
 #include <wchar.h>
 #include <locale.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 int is_vowel(unsigned char *c) { 
     if (*c == 'a' || *c == 'e' || *c == 'i' || *c == 'o' || *c == 'u' ||
@@ -135,4 +141,99 @@ char convert_special_chars(unsigned char c) {
         default:    break;
     }
     return c;
+}
+
+//classes of the ASCII characters, according to their role in a word
+enum CharClass { OTHER, VOWEL, CONSONANT, WORD_CHAR, APOSTROPHE, DELIMITER };
+
+//class of each ASCII character
+static unsigned char char_class[128];
+
+//bit of each consonant in the mask of consonants seen in a word
+static uint32_t consonant_bit[128];
+
+//flag which warrants that the tables are initialized exactly once
+static pthread_once_t tables_init = PTHREAD_ONCE_INIT;
+
+//Initialization of the tables, with the same rules as the multibyte path
+static void init_tables(void) {
+    unsigned char character[2] = {0, 0};
+
+    for (int c = 0; c < 128; c++) {
+        character[0] = c;
+        consonant_bit[c] = 0;
+
+        if (is_consonant(character)) {
+            char_class[c] = CONSONANT;
+            consonant_bit[c] = 1u << (tolower(c) - 'a');
+        } else if (is_vowel(character)) {
+            char_class[c] = VOWEL;
+        } else if (is_decimal_digit(character) || is_underscore(character)) {
+            char_class[c] = WORD_CHAR;
+        } else if (is_whitespace(character) || is_separation(character) || is_punctuation(character)) {
+            char_class[c] = DELIMITER;
+        } else if (is_apostrophe(character)) {
+            char_class[c] = APOSTROPHE;
+        } else {
+            char_class[c] = OTHER;
+        }
+    }
+}
+
+bool is_ascii(unsigned char *buffer, int size) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    //a byte is not ASCII if its most significant bit is set
+    __m256i acc256 = _mm256_setzero_si256();
+    for (; i + 32 <= size; i += 32)
+        acc256 = _mm256_or_si256(acc256, _mm256_loadu_si256((__m256i *) (buffer + i)));
+    if (_mm256_movemask_epi8(acc256) != 0) return false;
+#elif defined(__SSE2__)
+    __m128i acc128 = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16)
+        acc128 = _mm_or_si128(acc128, _mm_loadu_si128((__m128i *) (buffer + i)));
+    if (_mm_movemask_epi8(acc128) != 0) return false;
+#endif
+
+    //remaining bytes, 8 at a time
+    uint64_t acc = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, buffer + i, sizeof(word));
+        acc |= word;
+    }
+    for (; i < size; i++)
+        acc |= buffer[i];
+
+    return (acc & 0x8080808080808080ULL) == 0;
+}
+
+void count_words_ascii(unsigned char *buffer, int size, int *total_num_of_words, int *total_words_with_two_equal_consonants) {
+    pthread_once(&tables_init, init_tables);
+
+    bool inword = false;
+    uint32_t consonants_seen = 0;           //consonants that appeared in the current word
+    bool has_two_equal_consonants = false;
+
+    for (int i = 0; i < size; i++) {
+        unsigned char c = buffer[i];
+
+        if (inword) {
+            if (char_class[c] == CONSONANT) {
+                has_two_equal_consonants |= (consonants_seen & consonant_bit[c]) != 0;
+                consonants_seen |= consonant_bit[c];
+            } else if (char_class[c] == DELIMITER) {
+                inword = false;
+                if (has_two_equal_consonants)
+                    *total_words_with_two_equal_consonants += 1;
+                consonants_seen = 0;
+                has_two_equal_consonants = false;
+            }
+        } else if (char_class[c] == VOWEL || char_class[c] == CONSONANT || char_class[c] == WORD_CHAR) {
+            inword = true;
+            *total_num_of_words += 1;
+            consonants_seen = consonant_bit[c];
+        }
+    }
 }
\ No newline at end of file
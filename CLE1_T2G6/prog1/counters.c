@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <errno.h>
+#include <math.h>
 
 #include "constants.h"
 
@@ -12,6 +13,10 @@ struct FileCounters {
     char* file_name;
     int total_num_of_words;
     int total_words_with_two_equal_consonants;
+    int num_of_chunks;
+    int num_of_chunks_counted;
+    double sum_sq_words;
+    double sum_sq_words_with_two_equal_consonants;
 };
 
 //number of files
@@ -26,6 +31,26 @@ extern int *status_workers;
 //locking flag which warrants mutual exclusion inside the monitor
 static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;
 
+//Extrapolate the total of a counter from the chunks counted so far, with the half-width of its confidence interval
+static void extrapolate(double sum, double sum_sq, int n, int num_of_chunks, double *total, double *half_width) {
+    if (n == 0) {
+        *total = 0;
+        *half_width = 0;
+        return;
+    }
+
+    double mean = sum / n;
+    double variance = (n > 1) ? (sum_sq - n * mean * mean) / (n - 1) : 0;
+    if (variance < 0) variance = 0;
+
+    //simple random sampling without replacement, with the finite population correction
+    double fpc = 1.0 - (double) n / num_of_chunks;
+    if (fpc < 0) fpc = 0;
+
+    *total = mean * num_of_chunks;
+    *half_width = Z_CONFIDENCE * num_of_chunks * sqrt(fpc * variance / n);
+}
+
 //Save results and update the counters, performed by a worker thread
 void saveResults(int id, int file_id, int total_num_of_words, int total_words_with_two_equal_consonants) {
     //entering monitor
@@ -39,6 +64,9 @@ void saveResults(int id, int file_id, int total_num_of_words, int total_words_wi
 
     fmem[file_id].total_num_of_words += total_num_of_words;
     fmem[file_id].total_words_with_two_equal_consonants += total_words_with_two_equal_consonants;
+    fmem[file_id].num_of_chunks_counted += 1;
+    fmem[file_id].sum_sq_words += (double) total_num_of_words * total_num_of_words;
+    fmem[file_id].sum_sq_words_with_two_equal_consonants += (double) total_words_with_two_equal_consonants * total_words_with_two_equal_consonants;
 
     //exiting monitor
     if ((status_workers[id] = pthread_mutex_unlock (&accessCR)) != 0)
@@ -68,6 +96,10 @@ void storeFileNames(int n_file_names, char *file_names[]) {
         fmem[i].file_name = file_names[i];
         fmem[i].total_num_of_words = 0;
         fmem[i].total_words_with_two_equal_consonants = 0;
+        fmem[i].num_of_chunks = 0;
+        fmem[i].num_of_chunks_counted = 0;
+        fmem[i].sum_sq_words = 0;
+        fmem[i].sum_sq_words_with_two_equal_consonants = 0;
     }   
 
     //exiting monitor
@@ -93,6 +125,89 @@ void printResults (){
         printf("Number of words with at least two equal consonants: %d\n", fmem[i].total_words_with_two_equal_consonants);
     }
 
+    //exiting monitor
+    if ((pthread_mutex_unlock (&accessCR)) != 0) {
+       perror ("error on exiting monitor(CF)");
+       int status = EXIT_FAILURE;
+       pthread_exit(&status);
+    }
+}
+
+//Set the number of chunks of a file, performed by the main thread
+void setNumOfChunks(int file_id, int num_of_chunks) {
+    //entering monitor
+    if ((pthread_mutex_lock (&accessCR)) != 0) {
+       perror ("error on entering monitor(CF)");
+       int status = EXIT_FAILURE;
+       pthread_exit(&status);
+    }
+
+    fmem[file_id].num_of_chunks = num_of_chunks;
+
+    //exiting monitor
+    if ((pthread_mutex_unlock (&accessCR)) != 0) {
+       perror ("error on exiting monitor(CF)");
+       int status = EXIT_FAILURE;
+       pthread_exit(&status);
+    }
+}
+
+//Check if the estimates of a file are precise enough, performed by the main thread
+bool estimateReached(int file_id, double precision) {
+    double words, words_half_width, two_equal, two_equal_half_width;
+    bool reached;
+
+    //entering monitor
+    if ((pthread_mutex_lock (&accessCR)) != 0) {
+       perror ("error on entering monitor(CF)");
+       int status = EXIT_FAILURE;
+       pthread_exit(&status);
+    }
+
+    struct FileCounters *f = &fmem[file_id];
+
+    if (f->num_of_chunks_counted < MIN_SAMPLES && f->num_of_chunks_counted < f->num_of_chunks) {
+        reached = false;
+    } else {
+        extrapolate(f->total_num_of_words, f->sum_sq_words, f->num_of_chunks_counted, f->num_of_chunks, &words, &words_half_width);
+        extrapolate(f->total_words_with_two_equal_consonants, f->sum_sq_words_with_two_equal_consonants, f->num_of_chunks_counted, f->num_of_chunks,
+                    &two_equal, &two_equal_half_width);
+        reached = (words_half_width <= precision * words) && (two_equal_half_width <= precision * two_equal);
+    }
+
+    //exiting monitor
+    if ((pthread_mutex_unlock (&accessCR)) != 0) {
+       perror ("error on exiting monitor(CF)");
+       int status = EXIT_FAILURE;
+       pthread_exit(&status);
+    }
+
+    return reached;
+}
+
+//Print the estimated results, performed by the main thread
+void printEstimates (){
+    double words, words_half_width, two_equal, two_equal_half_width;
+
+    //entering monitor
+    if ((pthread_mutex_lock (&accessCR)) != 0) {
+       perror ("error on entering monitor(CF)");
+       int status = EXIT_FAILURE;
+       pthread_exit(&status);
+    }
+
+    for (int i = 0; i<num_of_files; i++) {
+        extrapolate(fmem[i].total_num_of_words, fmem[i].sum_sq_words, fmem[i].num_of_chunks_counted, fmem[i].num_of_chunks, &words, &words_half_width);
+        extrapolate(fmem[i].total_words_with_two_equal_consonants, fmem[i].sum_sq_words_with_two_equal_consonants, fmem[i].num_of_chunks_counted,
+                    fmem[i].num_of_chunks, &two_equal, &two_equal_half_width);
+
+        printf("\nFile name: %s\n", fmem[i].file_name);
+        printf("Chunks counted: %d of %d\n", fmem[i].num_of_chunks_counted, fmem[i].num_of_chunks);
+        printf("Estimated total number of words: %.0f +/- %.0f\n", words, words_half_width);
+        printf("Estimated number of words with at least two equal consonants: %.0f +/- %.0f\n", two_equal, two_equal_half_width);
+    }
+    printf("(95%% confidence intervals)\n");
+
     //exiting monitor
     if ((pthread_mutex_unlock (&accessCR)) != 0) {
        perror ("error on exiting monitor(CF)");
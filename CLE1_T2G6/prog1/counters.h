@@ -1,11 +1,17 @@
 #ifndef COUNTERS_H
 #define COUNTERS_H
 
+#include <stdbool.h>
+
 /** \brief struct to store the counters of a file*/
 struct FileCounters {
    char* file_name;        /* file name */  
    int total_num_of_words;    /* Number of total words */
    int total_words_with_two_equal_consonants;    /* Number of words with at least two equal consonants */
+   int num_of_chunks;    /* Number of chunks the file is split in (estimate mode) */
+   int num_of_chunks_counted;    /* Number of chunks whose results were saved */
+   double sum_sq_words;    /* Sum of the squares of the number of words per chunk */
+   double sum_sq_words_with_two_equal_consonants;    /* Sum of the squares of the number of words with two equal consonants per chunk */
 } FileCounters;
 
 /**
@@ -42,4 +48,37 @@ extern void saveResults (int id, int file_id, int total_words, int total_words_w
  */
 extern void printResults ();
 
+/**
+ *  \brief Set the number of chunks a file is split in, that is, the population of the sample.
+ *
+ *  Operation carried out by the main thread, in estimate mode.
+ *
+ *  \param file_id file identifier
+ *  \param num_of_chunks number of chunks of the file
+ */
+extern void setNumOfChunks (int file_id, int num_of_chunks);
+
+/**
+ *  \brief Check if the estimates of a file are precise enough.
+ *
+ *  Both counters must have a 95% confidence interval whose half-width is at most precision times the estimate,
+ *  with at least MIN_SAMPLES chunks counted (or all of them).
+ *
+ *  Operation carried out by the main thread, in estimate mode.
+ *
+ *  \param file_id file identifier
+ *  \param precision relative half-width of the confidence interval
+ *
+ *  \return true if the requested precision was reached
+ */
+extern bool estimateReached (int file_id, double precision);
+
+/**
+ *  \brief Print the estimated results with their confidence interval
+ *
+ *  Operation carried out by the main thread, in estimate mode.
+ *
+ */
+extern void printEstimates ();
+
 #endif /* COUNTERS_H */
\ No newline at end of file
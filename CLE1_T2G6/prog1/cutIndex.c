@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "constants.h"
+#include "countWordsFunctions.h"
+#include "cutIndex.h"
+
+//identification and version of the sidecar index format
+#define INDEX_MAGIC      "CWIX"
+#define INDEX_VERSION    1
+
+//struct used to store the header of the sidecar index
+struct IndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t file_size;        //size of the indexed file
+    int64_t mtime_sec;         //modification time of the indexed file
+    int64_t mtime_nsec;
+    uint32_t num_levels;       //number of granularities, each one is followed by its chunks
+};
+
+//struct used to store the header of one granularity of the sidecar index
+struct IndexLevel {
+    uint32_t granularity;      //nominal number of bytes of a chunk
+    uint32_t num_of_chunks;
+};
+
+//struct used to store one chunk in the sidecar index
+struct IndexEntry {
+    uint64_t offset;           //offset of the first byte of the chunk
+    uint32_t cut_offset;       //number of bytes until the safe-cut character
+    uint32_t cut_char_size;    //number of bytes of the safe-cut character (UTF-8 alignment of the cut)
+};
+
+//granularities stored in the sidecar index
+static const int granularities[] = INDEX_GRANULARITIES;
+
+//Build the name of the sidecar index of a file
+static char *indexName(char *file_name) {
+    char *index_name = malloc(strlen(file_name) + strlen(INDEX_SUFFIX) + 1);
+    strcpy(index_name, file_name);
+    strcat(index_name, INDEX_SUFFIX);
+    return index_name;
+}
+
+//Find the first safe place to cut a chunk at or after an offset of a file
+long nextSafeCut(FILE *file_pointer, long offset, long file_size, int *char_size) {
+    unsigned char character[3+1];      //the last byte of the character is required to be 0
+    int byte;
+
+    fseek(file_pointer, offset, SEEK_SET);
+
+    while ((byte = fgetc(file_pointer)) != EOF) {
+        *char_size = 1;
+        character[0] = byte;
+
+        //determine if the byte represents a 3-byte character or a single byte character
+        //safe-cut characters include whitespace (single byte), separation(single or multibyte), and punctuation(single or multibyte)
+        if (byte > 224 && byte < 240) {     // 3-byte char
+            character[1] = fgetc(file_pointer);
+            character[2] = fgetc(file_pointer);
+            character[3] = 0;
+            *char_size += 2;
+        } else {                            //it's a single byte char
+            character[1] = 0;
+        }
+
+        //if it is a safe place to cut the chunk, the chunk ends here
+        if (is_whitespace(character) || is_separation(character) || is_punctuation(character)) {
+            return offset;
+        }
+
+        offset += *char_size;
+    }
+
+    //there is no safe place until the end of the file
+    *char_size = 0;
+    return file_size;
+}
+
+//Find the first safe place to cut a chunk at or after an offset of a memory buffer
+long nextSafeCutInBuffer(unsigned char *buffer, long offset, long size, int *char_size) {
+    unsigned char character[3+1];      //the last byte of the character is required to be 0
+
+    while (offset < size) {
+        *char_size = 1;
+        character[0] = buffer[offset];
+
+        //a 3-byte character that is not complete in the buffer can't be a safe-cut character
+        if (buffer[offset] > 224 && buffer[offset] < 240) {     // 3-byte char
+            if (offset + 3 > size) break;
+            character[1] = buffer[offset + 1];
+            character[2] = buffer[offset + 2];
+            character[3] = 0;
+            *char_size += 2;
+        } else {                                                //it's a single byte char
+            character[1] = 0;
+        }
+
+        //if it is a safe place to cut the chunk, the chunk ends here
+        if (is_whitespace(character) || is_separation(character) || is_punctuation(character)) {
+            return offset;
+        }
+
+        offset += *char_size;
+    }
+
+    //there is no safe place until the end of the buffer
+    *char_size = 0;
+    return size;
+}
+
+//Split a file in chunks, recording where each one is cut
+static struct IndexEntry *splitEntries(FILE *file_pointer, long file_size, int chunk_size, int *num_of_chunks) {
+    int capacity = file_size / chunk_size + 1;
+    struct IndexEntry *entries = malloc(capacity * sizeof(struct IndexEntry));
+    long bytes_processed = 0;
+
+    *num_of_chunks = 0;
+
+    //while there are still bytes to create a chunk
+    while (bytes_processed < file_size) {
+        long current_chunk_size;
+        int current_char_size = 0;
+
+        if ( (bytes_processed + chunk_size) > file_size ) {
+            //the last chunk of the file has the remaining bytes
+            current_chunk_size = file_size - bytes_processed;
+        } else {
+            //the chunk has at least the default size and is extended so it doesn't cut a word or multibyte character
+            current_chunk_size = nextSafeCut(file_pointer, bytes_processed + chunk_size, file_size, &current_char_size) - bytes_processed;
+        }
+
+        if (*num_of_chunks == capacity) {
+            capacity *= 2;
+            entries = realloc(entries, capacity * sizeof(struct IndexEntry));
+        }
+        entries[*num_of_chunks].offset = bytes_processed;
+        entries[*num_of_chunks].cut_offset = current_chunk_size;
+        entries[*num_of_chunks].cut_char_size = current_char_size;
+        (*num_of_chunks)++;
+
+        bytes_processed += current_chunk_size;
+    }
+
+    return entries;
+}
+
+//Convert index entries to chunk bounds
+static struct ChunkBounds *toBounds(struct IndexEntry *entries, int num_of_chunks) {
+    struct ChunkBounds *chunks = malloc((num_of_chunks + 1) * sizeof(struct ChunkBounds));
+    for (int i = 0; i < num_of_chunks; i++) {
+        chunks[i].offset = entries[i].offset;
+        chunks[i].size = entries[i].cut_offset + entries[i].cut_char_size;
+    }
+    return chunks;
+}
+
+//Split a file in chunks
+struct ChunkBounds *splitFile(FILE *file_pointer, long file_size, int chunk_size, int *num_of_chunks) {
+    struct IndexEntry *entries = splitEntries(file_pointer, file_size, chunk_size, num_of_chunks);
+    struct ChunkBounds *chunks = toBounds(entries, *num_of_chunks);
+    free(entries);
+    return chunks;
+}
+
+//Read the chunks of one granularity from the sidecar index of a file
+struct ChunkBounds *loadCutIndex(char *file_name, int chunk_size, int *num_of_chunks) {
+    struct stat file_stat;
+    struct IndexHeader header;
+    struct IndexLevel level;
+
+    if (stat(file_name, &file_stat) != 0) return NULL;
+
+    char *index_name = indexName(file_name);
+    FILE *index_pointer = fopen(index_name, "rb");
+    free(index_name);
+    if (index_pointer == NULL) return NULL;
+
+    //the index is only valid for the exact version of the file it was built from
+    if (fread(&header, sizeof(header), 1, index_pointer) != 1 ||
+        memcmp(header.magic, INDEX_MAGIC, 4) != 0 || header.version != INDEX_VERSION ||
+        header.file_size != (uint64_t) file_stat.st_size ||
+        header.mtime_sec != file_stat.st_mtim.tv_sec || header.mtime_nsec != file_stat.st_mtim.tv_nsec) {
+        fclose(index_pointer);
+        return NULL;
+    }
+
+    for (uint32_t l = 0; l < header.num_levels; l++) {
+        if (fread(&level, sizeof(level), 1, index_pointer) != 1) break;
+
+        if (level.granularity != (uint32_t) chunk_size) {
+            fseek(index_pointer, (long) level.num_of_chunks * sizeof(struct IndexEntry), SEEK_CUR);
+            continue;
+        }
+
+        struct IndexEntry *entries = malloc((level.num_of_chunks + 1) * sizeof(struct IndexEntry));
+        if (level.num_of_chunks > 0 && fread(entries, sizeof(struct IndexEntry), level.num_of_chunks, index_pointer) != level.num_of_chunks) {
+            free(entries);
+            break;
+        }
+        fclose(index_pointer);
+
+        *num_of_chunks = level.num_of_chunks;
+        struct ChunkBounds *chunks = toBounds(entries, *num_of_chunks);
+        free(entries);
+        return chunks;
+    }
+
+    fclose(index_pointer);
+    return NULL;
+}
+
+//Split a file at every granularity and write its sidecar index
+static void writeCutIndex(char *file_name, FILE *file_pointer, long file_size, int chunk_size) {
+    struct stat file_stat;
+    struct IndexHeader header;
+
+    if (stat(file_name, &file_stat) != 0) return;
+
+    //the requested granularity is always indexed
+    int num_levels = sizeof(granularities) / sizeof(granularities[0]);
+    int levels[num_levels + 1];
+    bool has_chunk_size = false;
+    for (int l = 0; l < num_levels; l++) {
+        levels[l] = granularities[l];
+        if (levels[l] == chunk_size) has_chunk_size = true;
+    }
+    if (!has_chunk_size) levels[num_levels++] = chunk_size;
+
+    //the index is written to a temporary file and renamed, so concurrent readers never see it partially written
+    char *index_name = indexName(file_name);
+    char tmp_name[strlen(index_name) + 32];
+    snprintf(tmp_name, sizeof(tmp_name), "%s.%d", index_name, (int) getpid());
+
+    FILE *index_pointer = fopen(tmp_name, "wb");
+    if (index_pointer == NULL) {
+        fprintf(stderr, "Warning: could not write the index of %s\n", file_name);
+        free(index_name);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, 4);
+    header.version = INDEX_VERSION;
+    header.file_size = file_stat.st_size;
+    header.mtime_sec = file_stat.st_mtim.tv_sec;
+    header.mtime_nsec = file_stat.st_mtim.tv_nsec;
+    header.num_levels = num_levels;
+    bool ok = fwrite(&header, sizeof(header), 1, index_pointer) == 1;
+
+    for (int l = 0; l < num_levels && ok; l++) {
+        struct IndexLevel level;
+        int num_of_chunks;
+        struct IndexEntry *entries = splitEntries(file_pointer, file_size, levels[l], &num_of_chunks);
+
+        level.granularity = levels[l];
+        level.num_of_chunks = num_of_chunks;
+        ok = fwrite(&level, sizeof(level), 1, index_pointer) == 1 &&
+             (num_of_chunks == 0 || fwrite(entries, sizeof(struct IndexEntry), num_of_chunks, index_pointer) == (size_t) num_of_chunks);
+        free(entries);
+    }
+
+    if (fclose(index_pointer) != 0 || !ok || rename(tmp_name, index_name) != 0) {
+        fprintf(stderr, "Warning: could not write the index of %s\n", file_name);
+        unlink(tmp_name);
+    }
+
+    free(index_name);
+}
+
+//Get the chunks of a file, using its sidecar index when requested
+struct ChunkBounds *getChunkBounds(char *file_name, FILE *file_pointer, long file_size, int chunk_size, bool use_index, int *num_of_chunks) {
+    if (!use_index)
+        return splitFile(file_pointer, file_size, chunk_size, num_of_chunks);
+
+    struct ChunkBounds *chunks = loadCutIndex(file_name, chunk_size, num_of_chunks);
+    if (chunks != NULL) return chunks;
+
+    //the index is missing or stale: rebuild it
+    writeCutIndex(file_name, file_pointer, file_size, chunk_size);
+
+    chunks = loadCutIndex(file_name, chunk_size, num_of_chunks);
+    if (chunks != NULL) return chunks;
+
+    return splitFile(file_pointer, file_size, chunk_size, num_of_chunks);
+}
@@ -0,0 +1,88 @@
+#ifndef CUTINDEX_H
+#define CUTINDEX_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/** \brief struct to store the bounds of one chunk of a file*/
+struct ChunkBounds {
+   long offset;        /* Offset of the first byte of the chunk */
+   int size;           /* Number of bytes of the chunk, including the character where it was cut */
+};
+
+/**
+ *  \brief Find the first safe place to cut a chunk at or after an offset of a file.
+ *
+ *  Safe-cut characters are whitespace, separation and punctuation symbols. The returned offset is always the
+ *  start of a UTF-8 character.
+ *
+ *  \param file_pointer file to scan
+ *  \param offset offset where the scan starts
+ *  \param file_size number of bytes of the file
+ *  \param char_size number of bytes of the safe-cut character (0 if the end of the file was reached)
+ *
+ *  \return offset of the safe-cut character, or file_size if there is none
+ */
+extern long nextSafeCut (FILE * file_pointer, long offset, long file_size, int * char_size);
+
+/**
+ *  \brief Find the first safe place to cut a chunk at or after an offset of a memory buffer.
+ *
+ *  Same as nextSafeCut, for data that is already in memory (e.g. decompressed blocks).
+ *
+ *  \param buffer start of the data
+ *  \param offset offset where the scan starts
+ *  \param size number of bytes of the data
+ *  \param char_size number of bytes of the safe-cut character (0 if the end of the data was reached)
+ *
+ *  \return offset of the safe-cut character, or size if there is none
+ */
+extern long nextSafeCutInBuffer (unsigned char * buffer, long offset, long size, int * char_size);
+
+/**
+ *  \brief Split a file in chunks that don't cut words or multibyte characters.
+ *
+ *  Each chunk has at least chunk_size bytes (except the last one) and is extended up to the next safe-cut
+ *  character, which is also included in the chunk.
+ *
+ *  \param file_pointer file to split
+ *  \param file_size number of bytes of the file
+ *  \param chunk_size nominal number of bytes of a chunk
+ *  \param num_of_chunks number of chunks of the file
+ *
+ *  \return array with the bounds of the chunks (to be freed by the caller)
+ */
+extern struct ChunkBounds * splitFile (FILE * file_pointer, long file_size, int chunk_size, int * num_of_chunks);
+
+/**
+ *  \brief Get the chunks of a file, using its sidecar index when requested.
+ *
+ *  With use_index, the bounds are read from the sidecar index (file name + ".cutidx") if it exists and matches
+ *  the size and modification time of the file; otherwise the file is split at every granularity of the index,
+ *  the index is written and the requested granularity is returned.
+ *
+ *  \param file_name name of the file
+ *  \param file_pointer file to split, if the index can't be used
+ *  \param file_size number of bytes of the file
+ *  \param chunk_size nominal number of bytes of a chunk
+ *  \param use_index true to read (and write) the sidecar index
+ *  \param num_of_chunks number of chunks of the file
+ *
+ *  \return array with the bounds of the chunks (to be freed by the caller)
+ */
+extern struct ChunkBounds * getChunkBounds (char * file_name, FILE * file_pointer, long file_size, int chunk_size, bool use_index,
+                                            int * num_of_chunks);
+
+/**
+ *  \brief Read the chunks of one granularity from the sidecar index of a file.
+ *
+ *  \param file_name name of the file
+ *  \param chunk_size nominal number of bytes of a chunk
+ *  \param num_of_chunks number of chunks of the file
+ *
+ *  \return array with the bounds of the chunks (to be freed by the caller), or NULL if the index is missing,
+ *          stale or doesn't have that granularity
+ */
+extern struct ChunkBounds * loadCutIndex (char * file_name, int chunk_size, int * num_of_chunks);
+
+#endif /* CUTINDEX_H */
@@ -0,0 +1,125 @@
+#!/usr/bin/env bash
+#
+# Strong and weak scaling benchmark of the CLE2 word counter (prog1) and bitonic sort (prog2).
+#
+# Both programs are built with mpicc and run with mpirun on localhost for every number of processes in
+# RANKS. The inputs are generated on the fly: the word counter reads copies of dataSet1 concatenated, the
+# sort reads random integers in the dataSet2 format (number of integers followed by the integers).
+#
+# Usage: ./benchmark.sh [output.csv]
+#
+# Environment:
+#   RANKS          numbers of processes (default "1 2 4 8")
+#   TEXT_COPIES    copies of dataSet1 in the word counter input (default 50)
+#   SORT_SIZE      integers in the sort input (default 262144)
+#   REPEAT         runs of each configuration, the fastest one is kept (default 3)
+#   MPIRUN         mpirun command (default "mpirun --oversubscribe")
+#
+# Output (CSV): program, scaling, ranks, input_size, elapsed_s, speedup, efficiency, max_compute_s, max_comm_s
+#   strong: fixed input, speedup = T(first ranks) / T(ranks), efficiency = speedup * first ranks / ranks
+#   weak: input grows with the number of processes, efficiency = T(first ranks) / T(ranks)
+#   max_compute_s and max_comm_s are the largest per-rank times measured with MPI_Wtime
+
+set -euo pipefail
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+OUTPUT="${1:-/dev/stdout}"
+RANKS="${RANKS:-1 2 4 8}"
+TEXT_COPIES="${TEXT_COPIES:-50}"
+SORT_SIZE="${SORT_SIZE:-262144}"
+REPEAT="${REPEAT:-3}"
+MPIRUN="${MPIRUN:-mpirun --oversubscribe}"
+if [ "$(id -u)" = 0 ]; then
+    MPIRUN="$MPIRUN --allow-run-as-root"
+fi
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+# build both programs
+mpicc -O2 -o "$WORK/countWords" "$DIR"/prog1/*.c -lpthread
+mpicc -O2 -o "$WORK/sort" "$DIR"/prog2/*.c -lpthread
+
+# word counter input with a number of copies of dataSet1
+make_text() {
+    local file="$WORK/text_$1.txt"
+    if [ ! -f "$file" ]; then
+        for ((i = 0; i < $1; i++)); do
+            cat "$DIR"/prog1/dataSet1/*.txt
+        done > "$file"
+    fi
+    echo "$file"
+}
+
+# sort input with a number of random integers
+make_ints() {
+    local file="$WORK/ints_$1.bin"
+    if [ ! -f "$file" ]; then
+        local n=$1
+        printf "$(printf '\\%03o\\%03o\\%03o\\%03o' $((n & 255)) $((n >> 8 & 255)) $((n >> 16 & 255)) $((n >> 24 & 255)))" > "$file"
+        head -c $((4 * n)) /dev/urandom >> "$file"
+    fi
+    echo "$file"
+}
+
+# run a program and print "elapsed max_compute max_comm" of the fastest of REPEAT runs
+run() {
+    local ranks=$1 program=$2 input=$3 best=""
+    for ((r = 0; r < REPEAT; r++)); do
+        local out line
+        if [ "$program" = countWords ]; then
+            out="$($MPIRUN -n "$ranks" "$WORK/countWords" "$input")"
+            line="$(awk '/^Elapsed time/ { e = $4 } END { print e }' <<< "$out")"
+        else
+            out="$($MPIRUN -n "$ranks" "$WORK/sort" -f "$input")"
+            if ! grep -q '^SUCCESS!' <<< "$out"; then
+                echo "sort failed with $ranks processes" >&2
+                exit 1
+            fi
+            line="$(awk '/^Execution time:/ { e = $3 } END { print e }' <<< "$out")"
+        fi
+        line="$line $(awk '/^Rank [0-9]+:/ { if ($4 > c) c = $4; if ($7 > m) m = $7 } END { printf "%f %f", c, m }' <<< "$out")"
+        if [ -z "$best" ] || awk -v a="${line%% *}" -v b="${best%% *}" 'BEGIN { exit !(a < b) }'; then
+            best="$line"
+        fi
+    done
+    echo "$best"
+}
+
+# run a scaling sweep of a program and print its CSV rows
+sweep() {
+    local program=$1 scaling=$2 base_size=$3
+    local first_ranks="" first_time=""
+    for ranks in $RANKS; do
+        local size=$base_size input
+        if [ "$scaling" = weak ]; then
+            size=$((base_size * ranks))
+        fi
+        if [ "$program" = countWords ]; then
+            input="$(make_text "$size")"
+        else
+            input="$(make_ints "$size")"
+        fi
+
+        read -r elapsed compute comm <<< "$(run "$ranks" "$program" "$input")"
+        if [ -z "$first_ranks" ]; then
+            first_ranks=$ranks
+            first_time=$elapsed
+        fi
+
+        awk -v p="$program" -v s="$scaling" -v n="$ranks" -v size="$size" -v t="$elapsed" -v c="$compute" -v m="$comm" \
+            -v n1="$first_ranks" -v t1="$first_time" 'BEGIN {
+                speedup = t1 / t
+                efficiency = (s == "strong") ? speedup * n1 / n : speedup
+                printf "%s,%s,%d,%d,%.6f,%.3f,%.3f,%.6f,%.6f\n", p, s, n, size, t, speedup, efficiency, c, m
+            }'
+    done
+}
+
+{
+    echo "program,scaling,ranks,input_size,elapsed_s,speedup,efficiency,max_compute_s,max_comm_s"
+    sweep countWords strong "$TEXT_COPIES"
+    sweep countWords weak "$TEXT_COPIES"
+    sweep sort strong "$SORT_SIZE"
+    sweep sort weak "$SORT_SIZE"
+} > "$OUTPUT"
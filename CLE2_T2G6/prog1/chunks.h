@@ -0,0 +1,53 @@
+#ifndef CHUNKS_H
+#define CHUNKS_H
+
+#include <stdbool.h>
+
+#include "counted.h"
+
+/** \brief struct to store the information of one chunk*/
+struct ChunkInfo {
+   int file_id;        /* file identifier */
+   int chunk_size;    /* Number of bytes of the chunk */
+   unsigned char * chunk_info;  /* Pointer to the start of the chunk */
+   bool owned;        /* The chunk has its own buffer, to be freed after it is processed */
+   struct CountedMessage * counted;  /* Message whose counts are journaled, NULL to add the counts to the ones of the file */
+   int index;         /* Index of the chunk in the counted message */
+};
+
+/**
+ *  \brief Store a struct to inform that there are no more chunks to be processed.
+ *
+ *  Operation carried out by the main thread of a worker process.
+ *
+ */
+extern void endChunk();
+
+
+/**
+ *  \brief Store a chunk in the data transfer region.
+ *
+ *  Operation carried out by the main thread of a worker process, which receives the chunks.
+ *
+ *  \param buffer pointer to the start of the chunk
+ *  \param chunk_size number of bytes of the chunk
+ *  \param file_id file identifier
+ *  \param owned true if the buffer must be freed after the chunk is processed (false for chunks in mapped files)
+ *  \param counted message where the counts of the chunk are stored, NULL to add them to the ones of the file
+ *  \param index index of the chunk in the counted message
+ */
+extern void putChunk (unsigned char * buffer, unsigned int chunk_size, unsigned int file_id, bool owned,
+                      struct CountedMessage * counted, int index);
+
+/**
+ *  \brief Get a chunk from the data transfer region.
+ *
+ *  Operation carried out by the worker threads.
+ *
+ *  \param worker_id consumer identification
+ *
+ *  \return value
+ */
+extern struct ChunkInfo getChunk (unsigned int worker_id);
+
+#endif /* CHUNKS_H */
\ No newline at end of file
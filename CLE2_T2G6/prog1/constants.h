@@ -6,4 +6,33 @@
 /** \brief size of data chunk */
 #define  N           4000
 
+/** \brief default number of messages sent to a worker whose credits were not received yet */
+#define  CHUNKS_IN_FLIGHT     2
+
+/** \brief default number of chunks packed in one message */
+#define  CHUNKS_PER_MESSAGE   1
+
+/** \brief number of messages the reader thread of the dispatcher prepares ahead of the ones being sent */
+#define  MESSAGES_AHEAD       16
+
+/** \brief default number of worker threads of each worker process */
+#define  THREADS_PER_WORKER   1
+
+/** \brief data transfer region nominal capacity (in number of values that can be stored) in the FIFO of a worker process */
+#define  K            10
+
+/** \brief number of bytes a worker reads past the end of a byte range to find the safe cut point that ends it */
+#define  RANGE_LOOKAHEAD    256
+
+/** \brief number of seconds between the writes of the journal to disk */
+#define  JOURNAL_INTERVAL     5
+
+/* Chunk boundary index parameters */
+
+/** \brief suffix of the sidecar index of an input file */
+#define  INDEX_SUFFIX      ".cutidx"
+
+/** \brief nominal chunk sizes whose safe cut points are stored in the sidecar index */
+#define  INDEX_GRANULARITIES   { 1000, 4000, 16000, 64000 }
+
 #endif /* PROBCONST_H_ */
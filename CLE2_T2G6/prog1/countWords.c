@@ -4,38 +4,155 @@
 #include <string.h>
 #include <ctype.h> 
 #include <stdbool.h>
+#include <stdint.h>
 #include <wchar.h>
 #include <locale.h>
 #include <time.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <mpi.h>
 
+#include "chunks.h"
 #include "constants.h"
+#include "counted.h"
 #include "counters.h"
 #include "countWordsFunctions.h"
+#include "cutIndex.h"
+#include "journal.h"
+#include "messages.h"
+
+//struct used to store the counters of a worker thread, added to the ones of its process at the end
+struct WorkerThread {
+    unsigned int id;
+    int num_of_files;
+    int (*file_counts)[2];
+    long long path_bytes[2];
+    double compute_time;
+};
+
+//struct used to pass the chunk cursor to the reader thread of the dispatcher
+struct ReaderArgs {
+    struct ChunkCursor *cursor;
+    int chunks_per_message;
+};
 
-//struct used to store the results of a file
-struct FileResults {
-   int file_id;
-   int total_num_of_words;
-   int total_words_with_two_equal_consonants;
+//struct used to store the header of a message sent to a worker, followed by its chunk headers and their data
+struct MessageHeader {
+    uint32_t version;           //version of the message format
+    uint32_t num_of_chunks;     //number of chunks of the message, 0 means that there are no more chunks
 };
 
-//struct used to store the information of a chunk
-struct ChunkInfo {
-    int file_id;
-    int chunk_size;
-    unsigned char* chunk_info;
+//struct used to store the header of one chunk of a message
+struct ChunkHeader {
+    uint64_t file_id;
+    uint64_t offset;            //offset of the chunk in the file
+    uint64_t file_size;
+    uint32_t length;            //number of bytes of the chunk
+    uint32_t flags;             //CHUNK_RANGE or CHUNK_MAPPED if the worker reads the chunk by itself
+    uint32_t span;              //number of bytes from the offset of the chunk to the offset of the next chunk of the file
+};
+
+//version of the message format
+#define MESSAGE_VERSION     2
+
+//the chunk is a nominal byte range whose data is not in the message, the worker moves both ends to safe cut points
+#define CHUNK_RANGE         1
+
+//the chunk is a descriptor of exact bounds whose data is not in the message, the worker maps the file (same node only)
+#define CHUNK_MAPPED        2
+
+//struct used to store the files opened by a process to read the chunks that are not in the messages
+struct ProcessFiles {
+    char **file_names;
+    int num_of_files;
+    MPI_File *files;                //files opened to read byte ranges
+    unsigned char **maps;           //files mapped to read chunks given by their descriptors
+    size_t *map_sizes;
+};
+
+//struct used to iterate over the chunks of all the files
+struct ChunkCursor {
+    char **file_names;
+    int num_of_files;
+    bool use_index;
+    bool ranges;                    //only assign byte ranges, without reading the files
+    bool descriptors;               //only send the bounds of the chunks, without reading their data
+    int file_id;                    //file being split
+    FILE *file_pointer;
+    struct ChunkBounds *chunks;     //chunks of the file being split
+    long long file_size;
+    int num_of_chunks;
+    int next_chunk;                 //next chunk to be read
 };
 
 //dispatcher life cycle routine
-static void dispatcher(char *file_names[], int num_of_files);
+static void dispatcher(char *file_names[], int num_of_files, bool use_index, bool ranges, bool *local, int chunks_in_flight,
+                       int chunks_per_message, char *journal_name, bool resume, bool read_ahead, int (*file_counts)[2]);
+
+//write counted chunks in the journal, and add their counts to the ones of the dispatcher
+static void journalCounted(struct CountedChunk *counted_chunks, int num_of_chunks, int (*file_counts)[2]);
+
+//move the cursor to the next file that has chunks
+static bool openNextFile(struct ChunkCursor *cursor);
+
+//read the next chunk of the files into a new message
+static bool readNextChunk(struct ChunkCursor *cursor, struct ChunkHeader *header, unsigned char **data, int *data_size);
+
+//pack the next chunks of the files into a new message
+static bool readNextMessage(struct ChunkCursor *cursor, int chunks_per_message, unsigned char **message, int *message_size);
+
+//turn the chunks of a message into descriptors, for a worker on the same node
+static void toDescriptors(unsigned char *message, int *message_size);
+
+//reader thread life cycle routine, prepares the messages while the dispatcher sends them
+static void *reader(void *par);
+
+//get the next message, from the reader thread or by reading it when there is no reader thread
+static bool nextMessage(struct ReaderArgs *reader_args, bool read_ahead, unsigned char **message, int *message_size);
+
+//read a byte range of a file and move its ends to safe cut points
+static unsigned char *readRange(MPI_File file, struct ChunkHeader *range, unsigned char **chunk, int *chunk_size);
 
 //worker life cycle routine
-static void *worker(int rank);
+static void *worker(int rank, char *file_names[], int num_of_files, int num_of_threads, bool journaling, int (*file_counts)[2]);
+
+//count the words of the chunks of a message, returns false if it is the message that ends the worker
+static bool processMessage(int rank, unsigned char *message, struct ProcessFiles *process_files, int num_of_threads,
+                           int (*file_counts)[2], struct CountedMessage **counted);
+
+//send messages whose chunks were counted to the dispatcher, to be journaled, and free them
+static void sendCounted(struct CountedMessage *counted);
+
+//prepare and release the files of a process
+static void openProcessFiles(struct ProcessFiles *process_files, char *file_names[], int num_of_files);
+static void closeProcessFiles(struct ProcessFiles *process_files);
+
+//map a file, once, to read the chunks given by their descriptors
+static unsigned char *mapFile(struct ProcessFiles *process_files, int file_id, size_t file_size);
+
+//worker thread life cycle routine, in the processes that run a pool of threads
+static void *workerThread(void *par);
+
+//count the words of a chunk and add them to counters
+static void countChunk(struct ChunkInfo * chunk_info, int *counts, long long *path_bytes, double *compute_time);
+
+//process a chunk to count its words, returns true if it took the ASCII fast path
+static bool processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants);
+
+//byte i of a chunk, or 0 past its end
+#define CHUNK_BYTE(chunk, i)    ((i) < (chunk)->chunk_size ? (chunk)->chunk_info[i] : 0)
 
-//process a chunk to count its words 
-static void processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants);
+//process a chunk that has multibyte characters
+static void processMultibyteChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants);
+
+//number of bytes processed by this worker in the ASCII fast path and in the multibyte path
+static long long path_bytes[2];
+
+//seconds spent by this process counting words (added over its threads) and in MPI communication
+static double compute_time, comm_time;
 
 //number of workers
 int num_of_workers;
@@ -43,41 +160,144 @@ int num_of_workers;
 //number of bytes that a chunk should have
 int num_bytes = N;  
 
+//workers threads returns status array
+int *status_workers;
+
+//status of the main thread
+int status_main_producer;
+
+//status of the reader thread of the dispatcher
+int status_reader;
+
 
 int main(int argc, char *argv[]) {
 
-    int rank, size;
+    int rank, size, provided;
 
-    //initialize MPI
-    MPI_Init (&argc, &argv);
+    //initialize MPI, only the main thread of each process communicates
+    MPI_Init_thread (&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank (MPI_COMM_WORLD, &rank);
     MPI_Comm_size (MPI_COMM_WORLD, &size);
 
     //setlocale(LC_ALL, "en_US.UTF-8");
 
+    //parse the command line options
+    bool use_index = false;     //read the chunk boundaries from the sidecar index of each file
+    bool ranges = false;        //workers read the files themselves, the dispatcher only assigns byte ranges
+    bool copy = false;          //send the data of the chunks even to the workers on the node of the dispatcher
+    int chunks_in_flight = CHUNKS_IN_FLIGHT;        //messages sent to a worker whose credits were not received yet
+    int chunks_per_message = CHUNKS_PER_MESSAGE;    //chunks packed in one message
+    int num_of_threads = THREADS_PER_WORKER;        //worker threads of each worker process
+    char *journal_name = NULL;  //journal of the counted chunks
+    bool resume = false;        //only count the chunks that are not in the journal
+    int opt;
+    while ((opt = getopt(argc, argv, "ircw:b:t:j:R")) != -1) {
+        switch (opt) {
+            case 'i':
+                use_index = true;
+                break;
+            case 'r':
+                ranges = true;
+                break;
+            case 'c':
+                copy = true;
+                break;
+            case 'j':
+                journal_name = optarg;
+                break;
+            case 'R':
+                resume = true;
+                break;
+            case 'w':
+                if ((chunks_in_flight = atoi(optarg)) > 0) break;
+                goto usage;
+            case 'b':
+                if ((chunks_per_message = atoi(optarg)) > 0) break;
+                goto usage;
+            case 't':
+                if ((num_of_threads = atoi(optarg)) > 0) break;
+                //fall through
+            default:
+            usage:
+                if (rank == 0)
+                    fprintf(stderr, "Usage: mpiexec -n [number of processes] %s [-i | -r] [-c] [-w messages in flight per worker] [-b chunks per message] [-t threads per worker] [-j journal [-R]] file...\n", argv[0]);
+                MPI_Finalize();
+                return EXIT_FAILURE;
+        }
+    }
+
     num_of_workers = size - 1;
 
-    if(num_of_workers <= 0) {
-        fprintf(stderr, "You must have at least 1 worker, meaning, n value must be higher than 1. \n"); 
+    if (num_of_threads > 1 && provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0)
+            fprintf(stderr, "The MPI library doesn't support threads, -t can't be used. \n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    } else if (resume && journal_name == NULL) {
+        if (rank == 0)
+            fprintf(stderr, "-R requires -j. \n");
         MPI_Finalize();
         return EXIT_FAILURE;
     } else {
+        //measure time
+        struct timespec start_time, finish_time;
+        double elapsed_time;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+
+        //words and words with two equal consonants of each file, counted by this process
+        int num_of_files = argc - optind;
+        int file_counts[num_of_files][2];
+        memset(file_counts, 0, sizeof(file_counts));
+
+        //processes on the node of the dispatcher get descriptors of the chunks and map the files, instead of their bytes
+        MPI_Comm node_comm;
+        MPI_Group world_group, node_group;
+        int dispatcher_rank = 0, dispatcher_node_rank;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+        MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+        MPI_Comm_group(node_comm, &node_group);
+        MPI_Group_translate_ranks(world_group, 1, &dispatcher_rank, node_group, &dispatcher_node_rank);
+        int shares_node = (dispatcher_node_rank != MPI_UNDEFINED) && !copy && !ranges;
+        int shared_nodes[size];
+        MPI_Gather(&shares_node, 1, MPI_INT, shared_nodes, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Group_free(&world_group);
+        MPI_Group_free(&node_group);
+        MPI_Comm_free(&node_comm);
+
         if (rank == 0) {
 
-            //measure time
-            struct timespec start_time, finish_time;
-            double elapsed_time;
-            clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+            //workers that share the node of the dispatcher
+            bool local[size];
+            for (int i = 1; i < size; i++)
+                local[i-1] = shared_nodes[i];
 
             //read file names
-            char *file_names[argc-1];
+            char *file_names[argc-optind];
 
-            for (int i = 1; i<argc; i++) {
-                file_names[i-1] = argv[i];
+            for (int i = optind; i<argc; i++) {
+                file_names[i-optind] = argv[i];
             }
 
+            //initialize counters to 0 for each file
+            storeFileNames(num_of_files, file_names);
+
             //launch dispatcher
-            dispatcher(file_names, argc-1);
+            //without thread support, the dispatcher reads the messages itself instead of starting the reader thread
+            dispatcher(file_names, num_of_files, use_index, ranges, local, chunks_in_flight, chunks_per_message, journal_name, resume,
+                       provided >= MPI_THREAD_FUNNELED, file_counts);
+        } else {
+
+            //launch worker
+            worker(rank, &argv[optind], num_of_files, num_of_threads, journal_name != NULL, file_counts);
+        }
+
+        //add the counters of every worker, once for all the files
+        int total_counts[num_of_files][2];
+        MPI_Reduce(file_counts, total_counts, 2 * num_of_files, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            for (int i = 0; i < num_of_files; i++)
+                saveResults(i, total_counts[i][0], total_counts[i][1]);
 
             //measure time
             clock_gettime(CLOCK_MONOTONIC_RAW, &finish_time);
@@ -87,10 +307,24 @@ int main(int argc, char *argv[]) {
             //print final results
             printResults();
             printf("\nElapsed time = %.7f s\n", elapsed_time);
-        } else {
+        }
 
-            //launch worker
-            worker(rank);
+        //fraction of the bytes that took each path
+        long long total_path_bytes[2];
+        MPI_Reduce(path_bytes, total_path_bytes, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        if (rank == 0 && total_path_bytes[0] + total_path_bytes[1] > 0) {
+            printf("ASCII fast path: %.1f%% of bytes, multibyte path: %.1f%% of bytes\n",
+                   100.0 * total_path_bytes[0] / (total_path_bytes[0] + total_path_bytes[1]),
+                   100.0 * total_path_bytes[1] / (total_path_bytes[0] + total_path_bytes[1]));
+        }
+
+        //time each process spent computing and communicating
+        double times[2] = { compute_time, comm_time };
+        double all_times[2 * size];
+        MPI_Gather(times, 2, MPI_DOUBLE, all_times, 2, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            for (int i = 0; i < size; i++)
+                printf("Rank %d: compute %.6f s, communication %.6f s\n", i, all_times[2*i], all_times[2*i+1]);
         }
     }
 
@@ -98,207 +332,739 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
 }
 
-static void dispatcher(char *file_names[], int num_of_files) {
+//Move the cursor to the next file that has chunks, returns false if there are no more files
+static bool openNextFile(struct ChunkCursor *cursor) {
+    while (cursor->next_chunk >= cursor->num_of_chunks) {
 
-    bool msgRec[num_of_workers];
-    struct FileResults results[num_of_workers];
-
-    for (int i = 0; i < num_of_workers; i++) {
-        msgRec[i] = false;
-    }
-
-    //id of worker that will receive the next chunk to process
-    int current_worker_id = 1;
+        //close the file that was being split
+        free(cursor->chunks);
+        cursor->chunks = NULL;
+        if (cursor->file_pointer != NULL) {
+            fclose(cursor->file_pointer);
+            cursor->file_pointer = NULL;
+        }
 
-    //number of chunks sent to workers
-    int num_of_chunks_sent = 0;
+        if (++cursor->file_id >= cursor->num_of_files) return false;
+        cursor->next_chunk = 0;
 
-    //initialize counters to 0 for each file
-    storeFileNames(num_of_files, file_names);
+        //in range mode only the file size is needed, the data never passes through the dispatcher
+        //(the cursor is used by the reader thread, which can't call MPI)
+        if (cursor->ranges) {
+            struct stat file_stat;
+            if (stat(cursor->file_names[cursor->file_id], &file_stat) != 0) {
+                printf("It occoured an error while openning file: %s \n", cursor->file_names[cursor->file_id]);
+                exit(EXIT_FAILURE);
+            }
 
-    //generate the chunks of each file
-    for(int i=0; i<num_of_files; i++){
-        
-        FILE * file_pointer;
-        unsigned char byte;        //variable used to store each byte of the file  
-        unsigned char *character;  //variable used to store the char
+            cursor->file_size = file_stat.st_size;
+            cursor->num_of_chunks = (file_stat.st_size + num_bytes - 1) / num_bytes;
+            continue;
+        }
 
         //open file
-        file_pointer = fopen(file_names[i], "r");
-        if (file_pointer == NULL) {
-            printf("It occoured an error while openning file: %s \n", file_names[i]);
+        cursor->file_pointer = fopen(cursor->file_names[cursor->file_id], "r");
+        if (cursor->file_pointer == NULL) {
+            printf("It occoured an error while openning file: %s \n", cursor->file_names[cursor->file_id]);
             exit(EXIT_FAILURE);
         }
 
         //get file size
-        fseek(file_pointer, 0, SEEK_END);
-        int file_size = ftell(file_pointer);
+        fseek(cursor->file_pointer, 0, SEEK_END);
+        long file_size = ftell(cursor->file_pointer);
+        cursor->file_size = file_size;
 
-        //seek file to the start
-        fseek(file_pointer, 0, SEEK_SET);
-        int bytes_processed = 0;
-        int current_chunk_size;
+        //split the file in chunks that don't cut a word or multibyte character
+        cursor->chunks = getChunkBounds(cursor->file_names[cursor->file_id], cursor->file_pointer, file_size, num_bytes,
+                                        cursor->use_index, &cursor->num_of_chunks);
+    }
+    return true;
+}
 
-        //while there are still bytes to create a chunk 
-        while (bytes_processed < file_size) {
+//Read the next chunk of the files, returns false if there are no more chunks
+static bool readNextChunk(struct ChunkCursor *cursor, struct ChunkHeader *header, unsigned char **data, int *data_size) {
 
-            int current_char_size = 0; //number of bytes read for the current char (it can be single byte or multibyte)
+    //skip the chunks counted by the run that is being resumed
+    while (true) {
+        if (!openNextFile(cursor)) return false;
 
-            //if it is the last chunk of the file
-            if ( (bytes_processed + num_bytes) > file_size ) {
-                //size of current chunk will be the remaining bytes
-                current_chunk_size = file_size - bytes_processed;
-            } else {
-                current_chunk_size = num_bytes;  //chunk will have the default size of chunk
-                fseek(file_pointer, bytes_processed + current_chunk_size, SEEK_SET);       // Seek file to the end of chunk
-
-                //update the size of the chunk to ensure it doesn't cut a word or multibyte character
-                while (true) {                  
-                    byte = fgetc(file_pointer);
-
-                    current_char_size = 1;  
-                    character = malloc((1+1)* sizeof(unsigned char) );      //the last byte of the character is required to be 0
-                    character[0] = byte;
-
-                    //determine if the byte represents a 3-byte character or a single byte character
-                    //safe-cut characters include whitespace (single byte), separation(single or multibyte), and punctuation(single or multibyte)
-                    if ( byte > 224 && byte < 240) {     // 3-byte char
-                        // Create the 3-byte character
-                        character = realloc(character, (3+1)* sizeof(unsigned char) );      //reallocate memory to accomodate a 3-byte character
-                        byte = fgetc(file_pointer);    //read another byte
-                        character[1] = byte;
-                        byte = fgetc(file_pointer);    //read another byte
-                        character[2] = byte;
-                        character[3] = 0;
-                        current_char_size += 2;
-                    } else {                        //it's a single byte char
-                        character[1] = 0;
-                    }
+        long long offset = cursor->ranges ? (long long) cursor->next_chunk * num_bytes : cursor->chunks[cursor->next_chunk].offset;
+        if (!isChunkDone(cursor->file_id, offset)) break;
+        cursor->next_chunk++;
+    }
 
-                    //if it is a safe place to cut the chunk, so we break
-                    if (is_whitespace(character) || is_separation(character) || is_punctuation(character)) {
-                        break;
-                    }
+    header->file_id = cursor->file_id;
+
+    //a range is the k-th block of N bytes of the file
+    if (cursor->ranges) {
+        header->offset = (uint64_t) cursor->next_chunk++ * num_bytes;
+        header->length = num_bytes;
+        header->file_size = cursor->file_size;
+        header->flags = CHUNK_RANGE;
+        long long remaining = cursor->file_size - (long long) header->offset;
+        header->span = (remaining < num_bytes) ? remaining : num_bytes;
+        *data_size = 0;
+        return true;
+    }
 
-                    //increment the size of chunk
-                    current_chunk_size += current_char_size;
-                }
-            }
+    struct ChunkBounds *bounds = &cursor->chunks[cursor->next_chunk++];
 
-            //seek file to the initial of the chunk
-            fseek(file_pointer, bytes_processed, SEEK_SET);
+    header->offset = bounds->offset;
+    header->length = bounds->size;
+    header->file_size = cursor->file_size;
+    header->flags = 0;
 
-            //array with chunk information
-            unsigned char * chunk = (unsigned char*) malloc(current_chunk_size + current_char_size + sizeof(int));
-            chunk[0] = i;
-            int s = fread(chunk+1, current_chunk_size + current_char_size, 1, file_pointer);
-            if (s != 1)
-                printf("Error creating chunk buffer.");
+    //the chunk ends with the character at its safe cut point, which is also the first one of the next chunk
+    header->span = ((cursor->next_chunk < cursor->num_of_chunks) ? cursor->chunks[cursor->next_chunk].offset : cursor->file_size) -
+                   bounds->offset;
 
-            MPI_Send(chunk, current_chunk_size + current_char_size + sizeof(int), MPI_BYTE, current_worker_id, 1, MPI_COMM_WORLD);
-            
-            //update current_worker_id and num_of_chunks_sent variables
-            current_worker_id = (current_worker_id % num_of_workers) + 1;
-            num_of_chunks_sent += 1;
+    //the worker maps the file, so the data is not read
+    if (cursor->descriptors) {
+        header->flags = CHUNK_MAPPED;
+        return true;
+    }
 
-            bytes_processed += current_chunk_size;
+    //seek file to the initial of the chunk
+    fseek(cursor->file_pointer, bounds->offset, SEEK_SET);
 
-            if (num_of_chunks_sent >= num_of_workers) {
+    //the data of the chunk is appended to the message
+    *data = realloc(*data, *data_size + bounds->size);
+    int s = fread(*data + *data_size, bounds->size, 1, cursor->file_pointer);
+    if (s != 1)
+        printf("Error creating chunk buffer.");
+    *data_size += bounds->size;
 
-                //check if results from workers are available
-                for (int i = 1; i <= num_of_workers; i++) {
+    return true;
+}
+
+//Turn the chunks of a message into descriptors, dropping their data
+static void toDescriptors(unsigned char *message, int *message_size) {
+    struct MessageHeader *header = (struct MessageHeader *) message;
+    struct ChunkHeader *chunk_headers = (struct ChunkHeader *) (message + sizeof(struct MessageHeader));
 
-                    if (!msgRec[i-1]) {
-                        MPI_Recv(&results[i-1], sizeof(struct FileResults), MPI_BYTE, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    for (uint32_t c = 0; c < header->num_of_chunks; c++)
+        if (chunk_headers[c].flags == 0)
+            chunk_headers[c].flags = CHUNK_MAPPED;
 
-                        //save results
-                        saveResults(results[i-1].file_id, results[i-1].total_num_of_words, results[i-1].total_words_with_two_equal_consonants);
+    *message_size = sizeof(struct MessageHeader) + header->num_of_chunks * sizeof(struct ChunkHeader);
+}
+
+//Pack up to chunks_per_message chunks of the files into a new message, returns false if there are no more chunks
+static bool readNextMessage(struct ChunkCursor *cursor, int chunks_per_message, unsigned char **message, int *message_size) {
+    struct ChunkHeader *headers = malloc(chunks_per_message * sizeof(struct ChunkHeader));
+    unsigned char *data = NULL;
+    int data_size = 0;
+    int num_of_chunks = 0;
+
+    while (num_of_chunks < chunks_per_message && readNextChunk(cursor, &headers[num_of_chunks], &data, &data_size))
+        num_of_chunks++;
+
+    if (num_of_chunks == 0) {
+        free(headers);
+        return false;
+    }
+
+    //header, chunk headers and the data of the chunks, in the same order
+    int headers_size = sizeof(struct MessageHeader) + num_of_chunks * sizeof(struct ChunkHeader);
+    *message_size = headers_size + data_size;
+    *message = malloc(*message_size);
+
+    struct MessageHeader *header = (struct MessageHeader *) *message;
+    header->version = MESSAGE_VERSION;
+    header->num_of_chunks = num_of_chunks;
+    memcpy(*message + sizeof(struct MessageHeader), headers, num_of_chunks * sizeof(struct ChunkHeader));
+    if (data_size > 0)
+        memcpy(*message + headers_size, data, data_size);
+
+    free(headers);
+    free(data);
+    return true;
+}
 
-                        num_of_chunks_sent -= 1;
-                        msgRec[i-1] = false;
+static void dispatcher(char *file_names[], int num_of_files, bool use_index, bool ranges, bool *local, int chunks_in_flight,
+                       int chunks_per_message, char *journal_name, bool resume, bool read_ahead, int (*file_counts)[2]) {
+
+    //the arrays have one more element so they are never empty when the dispatcher has no workers
+    //requests and buffers of the messages in flight of each worker
+    MPI_Request send_requests[num_of_workers + 1][chunks_in_flight];
+    unsigned char *send_buffers[num_of_workers + 1][chunks_in_flight];
+
+    //requests of the credits of each worker, one credit is returned for every message processed,
+    //followed by the request of the counted chunks of the messages processed by the workers, when there is a journal
+    MPI_Request recv_requests[num_of_workers + 1];
+    MPI_Status statuses[num_of_workers + 1];
+    int num_of_requests = num_of_workers + (journal_name != NULL);
+    struct CountedChunk *counted_chunks = (journal_name != NULL) ? malloc(chunks_per_message * sizeof(struct CountedChunk)) : NULL;
+    int num_counted = 0;
+
+    //number of messages in flight and number of messages sent, per worker
+    int in_flight[num_of_workers + 1];
+    int num_sent[num_of_workers + 1];
+    int total_in_flight = 0;
+
+    int completed[num_of_workers + 1];
+    int num_completed;
+
+    //files opened to read the chunks of the messages processed by the dispatcher
+    struct ProcessFiles process_files;
+    openProcessFiles(&process_files, file_names, num_of_files);
+    int num_of_messages = 0, num_processed = 0;
+
+    //when every worker shares the node of the dispatcher, the data of the chunks is never read by the dispatcher
+    bool all_local = !ranges;
+    for (int w = 0; w < num_of_workers; w++)
+        all_local = all_local && local[w];
+
+    struct ChunkCursor cursor = { file_names, num_of_files, use_index, ranges, all_local, -1, NULL, NULL, 0, 0, 0 };
+    struct ReaderArgs reader_args = { &cursor, chunks_per_message };
+    bool more_chunks = true;
+    int *thread_status;
+
+    //the journal is loaded before the reader thread starts, so it skips the chunks already counted
+    if (journal_name != NULL) {
+        long long done_bytes = openJournal(journal_name, file_names, num_of_files, ranges, num_bytes, resume, file_counts);
+        if (resume)
+            printf("Resuming from %s: %lld bytes were already counted\n", journal_name, done_bytes);
+    }
+
+    //the files are read by another thread, so reading the next messages overlaps with sending the current ones
+    pthread_t tIdReader;
+    if (read_ahead && pthread_create (&tIdReader, NULL, reader, &reader_args) != 0)
+    {
+        perror ("error on creating reader thread");
+        exit (EXIT_FAILURE);
+    }
+
+    recv_requests[num_of_workers] = MPI_REQUEST_NULL;
+    for (int w = 0; w < num_of_workers; w++) {
+        in_flight[w] = 0;
+        num_sent[w] = 0;
+        recv_requests[w] = MPI_REQUEST_NULL;
+        for (int slot = 0; slot < chunks_in_flight; slot++) {
+            send_requests[w][slot] = MPI_REQUEST_NULL;
+            send_buffers[w][slot] = NULL;
+        }
+    }
+
+    //fill the window of every worker, one chunk each at a time
+    for (int slot = 0; slot < chunks_in_flight && more_chunks; slot++) {
+        for (int w = 0; w < num_of_workers && more_chunks; w++) {
+            unsigned char *message;
+            int message_size;
+
+            if (!(more_chunks = nextMessage(&reader_args, read_ahead, &message, &message_size))) break;
+
+            num_of_messages++;
+            if (local[w]) toDescriptors(message, &message_size);
+            send_buffers[w][slot] = message;
+            double t = MPI_Wtime();
+            MPI_Isend(message, message_size, MPI_BYTE, w + 1, 1, MPI_COMM_WORLD, &send_requests[w][slot]);
+            comm_time += MPI_Wtime() - t;
+            num_sent[w]++;
+            in_flight[w]++;
+            total_in_flight++;
+        }
+    }
+
+    //wait for the credits of the workers that have chunks in flight
+    for (int w = 0; w < num_of_workers; w++) {
+        if (in_flight[w] > 0)
+            MPI_Irecv(NULL, 0, MPI_INT, w + 1, 0, MPI_COMM_WORLD, &recv_requests[w]);
+    }
+
+    while (total_in_flight > 0 || more_chunks) {
+
+        //the counted chunks are received while some message processed by a worker was not journaled yet
+        if (journal_name != NULL && recv_requests[num_of_workers] == MPI_REQUEST_NULL && num_counted < num_of_messages - num_processed)
+            MPI_Irecv(counted_chunks, chunks_per_message * sizeof(struct CountedChunk), MPI_BYTE, MPI_ANY_SOURCE, 2, MPI_COMM_WORLD,
+                      &recv_requests[num_of_workers]);
+
+        if (more_chunks) {
+            //while there are more messages, every worker has a full window: if no credit has arrived,
+            //the dispatcher processes the next message itself instead of waiting
+            double t = MPI_Wtime();
+            MPI_Testsome(num_of_requests, recv_requests, &num_completed, completed, statuses);
+            comm_time += MPI_Wtime() - t;
+            if (num_completed == 0 || num_completed == MPI_UNDEFINED) {
+                unsigned char *message;
+                int message_size;
+                if ((more_chunks = nextMessage(&reader_args, read_ahead, &message, &message_size))) {
+                    if (journal_name != NULL) {
+                        struct CountedMessage *counted;
+                        processMessage(0, message, &process_files, 1, file_counts, &counted);
+                        journalCounted(counted->chunks, counted->num_of_chunks, file_counts);
+                        free(counted->chunks);
+                        free(counted);
+                    } else {
+                        processMessage(0, message, &process_files, 1, file_counts, NULL);
                     }
+                    free(message);
+                    num_of_messages++;
+                    num_processed++;
                 }
+                continue;
             }
+        } else {
+            //handle every credit that has arrived
+            double t = MPI_Wtime();
+            MPI_Waitsome(num_of_requests, recv_requests, &num_completed, completed, statuses);
+            comm_time += MPI_Wtime() - t;
         }
 
-        //close file
-        fclose(file_pointer);
-    }
-
-    //receive results of last chunks from workers
-    while (num_of_chunks_sent > 0) {
-        for (int i = 1; i <= num_of_workers; i++) {
+        for (int c = 0; c < num_completed; c++) {
+            int w = completed[c];
 
-            if (!msgRec[i-1]) {
-                MPI_Recv(&results[i-1], sizeof(struct FileResults), MPI_BYTE, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            //the counted chunks of a message processed by a worker
+            if (w == num_of_workers) {
+                int counted_size;
+                MPI_Get_count(&statuses[c], MPI_BYTE, &counted_size);
+                journalCounted(counted_chunks, counted_size / sizeof(struct CountedChunk), file_counts);
+                num_counted++;
+                continue;
+            }
 
-                //save results
-                saveResults(results[i-1].file_id, results[i-1].total_num_of_words, results[i-1].total_words_with_two_equal_consonants);
-            
-                num_of_chunks_sent-=1;
-                msgRec[i-1] = false;
+            in_flight[w]--;
+            total_in_flight--;
+
+            //the worker that returned a credit gets the next message
+            unsigned char *message;
+            int message_size;
+            if (more_chunks && (more_chunks = nextMessage(&reader_args, read_ahead, &message, &message_size))) {
+                //the oldest message of the worker was already received, so its buffer can be reused
+                num_of_messages++;
+                int slot = num_sent[w] % chunks_in_flight;
+                double t = MPI_Wtime();
+                MPI_Wait(&send_requests[w][slot], MPI_STATUS_IGNORE);
+                free(send_buffers[w][slot]);
+
+                if (local[w]) toDescriptors(message, &message_size);
+                send_buffers[w][slot] = message;
+                MPI_Isend(message, message_size, MPI_BYTE, w + 1, 1, MPI_COMM_WORLD, &send_requests[w][slot]);
+                comm_time += MPI_Wtime() - t;
+                num_sent[w]++;
+                in_flight[w]++;
+                total_in_flight++;
             }
+
+            if (in_flight[w] > 0)
+                MPI_Irecv(NULL, 0, MPI_INT, w + 1, 0, MPI_COMM_WORLD, &recv_requests[w]);
+        }
+    }
+
+    //free the buffers of the last messages
+    for (int w = 0; w < num_of_workers; w++) {
+        for (int slot = 0; slot < chunks_in_flight; slot++) {
+            MPI_Wait(&send_requests[w][slot], MPI_STATUS_IGNORE);
+            free(send_buffers[w][slot]);
         }
     }
 
-    
+    //waiting for the termination of the reader thread
+    if (read_ahead && pthread_join (tIdReader, (void *) &thread_status) != 0)
+    {
+        perror ("Error on waiting for thread reader");
+        exit (EXIT_FAILURE);
+    }
+
     //send message to each process to know that there are no more chunks to process
+    struct MessageHeader last_message = { MESSAGE_VERSION, 0 };
     for (int i = 1; i <= num_of_workers; i++) {
-        unsigned char* last_chunk = malloc(sizeof(unsigned char));
-        last_chunk[0] = 255;
+        //send message without chunks to Worker
+        MPI_Send(&last_message, sizeof(struct MessageHeader), MPI_BYTE, i, 1, MPI_COMM_WORLD);
+    }
+
+    //the worker threads may still be counting the last messages, whose counted chunks are sent once they end
+    while (journal_name != NULL && num_counted < num_of_messages - num_processed) {
+        MPI_Status status;
+        int counted_size;
+        if (recv_requests[num_of_workers] == MPI_REQUEST_NULL)
+            MPI_Irecv(counted_chunks, chunks_per_message * sizeof(struct CountedChunk), MPI_BYTE, MPI_ANY_SOURCE, 2, MPI_COMM_WORLD,
+                      &recv_requests[num_of_workers]);
+        MPI_Wait(&recv_requests[num_of_workers], &status);
+        MPI_Get_count(&status, MPI_BYTE, &counted_size);
+        journalCounted(counted_chunks, counted_size / sizeof(struct CountedChunk), file_counts);
+        num_counted++;
+    }
+    free(counted_chunks);
+
+    closeProcessFiles(&process_files);
+    if (journal_name != NULL)
+        closeJournal();
+
+    printf("Messages processed by the dispatcher: %d of %d\n", num_processed, num_of_messages);
+}
 
-        //send special chunk to Worker
-        MPI_Send(last_chunk, sizeof(unsigned char), MPI_BYTE, i, 1, MPI_COMM_WORLD);
+//Write counted chunks in the journal, and add their counts to the ones of the dispatcher
+static void journalCounted(struct CountedChunk *counted_chunks, int num_of_chunks, int (*file_counts)[2]) {
+    for (int c = 0; c < num_of_chunks; c++) {
+        journalChunk(counted_chunks[c].file_id, counted_chunks[c].offset, counted_chunks[c].span, counted_chunks[c].counts[0],
+                     counted_chunks[c].counts[1]);
+        file_counts[counted_chunks[c].file_id][0] += counted_chunks[c].counts[0];
+        file_counts[counted_chunks[c].file_id][1] += counted_chunks[c].counts[1];
     }
+}
+
+//its role is to read the files and store the prepared messages in the ring, ahead of the dispatcher
+static void *reader(void *par) {
+    struct ReaderArgs *args = (struct ReaderArgs *) par;
+    unsigned char *message;
+    int message_size;
+
+    while (readNextMessage(args->cursor, args->chunks_per_message, &message, &message_size))
+        putMessage(message, message_size);
 
+    endMessages();
+
+    status_reader = EXIT_SUCCESS;
+    pthread_exit (&status_reader);
 }
 
-//its role is to get chunks of data and count the words. After that, it incrementes the counters in shared region.
-static void *worker(int rank) {
+//Get the next message, from the reader thread or by reading it, returns false if there are no more messages
+static bool nextMessage(struct ReaderArgs *reader_args, bool read_ahead, unsigned char **message, int *message_size) {
+    if (read_ahead)
+        return getMessage(message, message_size);
+    return readNextMessage(reader_args->cursor, reader_args->chunks_per_message, message, message_size);
+}
 
-    while (true) {
+//its role is to get chunks of data and count the words, by itself or by a pool of threads. After that, it incrementes its own counters of the file.
+static void *worker(int rank, char *file_names[], int num_of_files, int num_of_threads, bool journaling, int (*file_counts)[2]) {
+
+    //chunks of each message, with their counts, sent to the dispatcher once they are counted when it keeps a journal
+    struct CountedMessage *counted;
+
+    //files opened to read the chunks that are not in the messages
+    struct ProcessFiles process_files;
+    openProcessFiles(&process_files, file_names, num_of_files);
+
+    //with more than one thread, the main thread only communicates and the chunks go to the FIFO of the worker threads
+    pthread_t tIdWorkers[num_of_threads];
+    struct WorkerThread threads[num_of_threads];
+    if (num_of_threads > 1) {
+        status_workers = malloc(num_of_threads * sizeof(int));
+        for (int i = 0; i < num_of_threads; i++) {
+            threads[i].id = i;
+            threads[i].num_of_files = num_of_files;
+            threads[i].file_counts = calloc(num_of_files, sizeof(int[2]));
+            threads[i].path_bytes[0] = threads[i].path_bytes[1] = 0;
+            threads[i].compute_time = 0;
+
+            if (pthread_create (&tIdWorkers[i], NULL, workerThread, &threads[i]) != 0)
+            {
+                perror ("error on creating worker thread");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
 
-        //struct to get chunk of data
-        struct ChunkInfo new_chunk;
+    while (true) {
 
         //get message size
         MPI_Status status;
+        double t = MPI_Wtime();
         MPI_Probe(0, 1, MPI_COMM_WORLD, &status);
         int message_size;
         MPI_Get_count(&status, MPI_BYTE, &message_size);
 
-        //alocate memory to read the chunk information
-        new_chunk.chunk_info = (unsigned char*) malloc(message_size);
-        MPI_Recv(new_chunk.chunk_info, message_size, MPI_BYTE, 0, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        //alocate memory to read the message
+        unsigned char *message = (unsigned char*) malloc(message_size);
+        MPI_Recv(message, message_size, MPI_BYTE, 0, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        comm_time += MPI_Wtime() - t;
 
-        //checks if it is the chunk that tells that there are no more chunks to process
-        if (new_chunk.chunk_info[0] == 255) break;
+        if (!processMessage(rank, message, &process_files, num_of_threads, file_counts, journaling ? &counted : NULL)) {
+            free(message);
+            break;
+        }
 
-        //convert info to the struct ChunkInfo
-        new_chunk.file_id = new_chunk.chunk_info[0];
-        new_chunk.chunk_info = new_chunk.chunk_info + 1;
-        new_chunk.chunk_size = message_size - sizeof(int);
+        //free the memory of the message
+        free(message);
 
-        //process chunk of data
-        int total_num_of_words = 0;
-        int total_words_with_two_equal_consonants = 0;
-        processChunk(&new_chunk, &total_num_of_words, &total_words_with_two_equal_consonants);
+        //with a journal, the counts of the chunks are sent to the dispatcher instead of being added to the ones of the worker
+        //(the chunks in the FIFO are sent once the worker threads count them)
+        if (journaling && num_of_threads == 1)
+            sendCounted(counted);
 
-        //free the memory of the buffer
-        free(new_chunk.chunk_info-1);
+        //the dispatcher just gets a credit to send the next message, once the chunks are processed or in the FIFO
+        t = MPI_Wtime();
+        MPI_Send(NULL, 0, MPI_INT, 0, 0, MPI_COMM_WORLD);
+        comm_time += MPI_Wtime() - t;
+
+        if (journaling && num_of_threads > 1)
+            sendCounted(getCountedMessages());
+    }
+
+    if (num_of_threads > 1) {
+        int *thread_status;
+
+        //save a struct in fifo for each thread to know that there are no more chunks to process
+        for (int i = 0; i < num_of_threads; i++)
+            endChunk();
+
+        //waiting for the termination of the worker threads and adding their counters to the ones of the process
+        for (int i = 0; i < num_of_threads; i++) {
+            if (pthread_join (tIdWorkers[i], (void *) &thread_status) != 0)
+            {
+                perror ("Error on waiting for thread worker");
+                exit (EXIT_FAILURE);
+            }
+
+            for (int f = 0; f < num_of_files; f++) {
+                file_counts[f][0] += threads[i].file_counts[f][0];
+                file_counts[f][1] += threads[i].file_counts[f][1];
+            }
+            path_bytes[0] += threads[i].path_bytes[0];
+            path_bytes[1] += threads[i].path_bytes[1];
+            compute_time += threads[i].compute_time;
+            free(threads[i].file_counts);
+        }
+        free(status_workers);
 
-        //send results back to dispatcher
-        struct FileResults results;
-        results.file_id = new_chunk.file_id;
-        results.total_num_of_words = total_num_of_words;
-        results.total_words_with_two_equal_consonants = total_words_with_two_equal_consonants;
-        
-        MPI_Send(&results, sizeof(struct FileResults), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+        //the messages counted after the last one was received
+        if (journaling)
+            sendCounted(getCountedMessages());
     }
+
+    closeProcessFiles(&process_files);
+
     return 0;
 }
 
-static void processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants) {
+//Count the words of the chunks of a message, by itself or by putting them in the FIFO of the worker threads
+static bool processMessage(int rank, unsigned char *message, struct ProcessFiles *process_files, int num_of_threads,
+                           int (*file_counts)[2], struct CountedMessage **counted) {
+    MPI_File *files = process_files->files;
+    char **file_names = process_files->file_names;
+
+    struct MessageHeader *header = (struct MessageHeader *) message;
+    if (header->version != MESSAGE_VERSION) {
+        fprintf(stderr, "Worker %d: unsupported message version %u\n", rank, header->version);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    //checks if it is the message that tells that there are no more chunks to process
+    if (header->num_of_chunks == 0) return false;
+
+    struct ChunkHeader *chunk_headers = (struct ChunkHeader *) (message + sizeof(struct MessageHeader));
+    unsigned char *data = message + sizeof(struct MessageHeader) + header->num_of_chunks * sizeof(struct ChunkHeader);
+
+    //the counts of the chunks go to a counted message, to be journaled
+    struct CountedMessage *chunks_counted = NULL;
+    if (counted != NULL) {
+        chunks_counted = malloc(sizeof(struct CountedMessage));
+        chunks_counted->num_of_chunks = header->num_of_chunks;
+        chunks_counted->num_counted = 0;
+        chunks_counted->chunks = calloc(header->num_of_chunks, sizeof(struct CountedChunk));
+        chunks_counted->next = NULL;
+        for (uint32_t c = 0; c < header->num_of_chunks; c++) {
+            chunks_counted->chunks[c].file_id = chunk_headers[c].file_id;
+            chunks_counted->chunks[c].offset = chunk_headers[c].offset;
+            chunks_counted->chunks[c].span = chunk_headers[c].span;
+        }
+        *counted = chunks_counted;
+    }
+
+    for (uint32_t c = 0; c < header->num_of_chunks; c++) {
+
+        //struct to get chunk of data
+        struct ChunkInfo new_chunk;
+        unsigned char *buffer = NULL;       //memory to free after processing the chunk
+        int file_id = chunk_headers[c].file_id;
+
+        new_chunk.file_id = file_id;
+
+        if (chunk_headers[c].flags & CHUNK_RANGE) {
+            //a byte range that the process reads by itself
+            if (files[file_id] == MPI_FILE_NULL &&
+                MPI_File_open(MPI_COMM_SELF, file_names[file_id], MPI_MODE_RDONLY, MPI_INFO_NULL, &files[file_id]) != MPI_SUCCESS) {
+                printf("It occoured an error while openning file: %s \n", file_names[file_id]);
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+
+            buffer = readRange(files[file_id], &chunk_headers[c], &new_chunk.chunk_info, &new_chunk.chunk_size);
+        } else if (chunk_headers[c].flags & CHUNK_MAPPED) {
+            //a chunk of a file on the same node, read in place
+            new_chunk.chunk_info = mapFile(process_files, file_id, chunk_headers[c].file_size) + chunk_headers[c].offset;
+            new_chunk.chunk_size = chunk_headers[c].length;
+        } else {
+            new_chunk.chunk_info = data;
+            new_chunk.chunk_size = chunk_headers[c].length;
+            data += chunk_headers[c].length;
+        }
+
+        if (num_of_threads > 1) {
+            //the chunk gets its own buffer, freed by the worker thread that processes it, unless it is in a mapped file
+            if (chunk_headers[c].flags & CHUNK_MAPPED) {
+                putChunk(new_chunk.chunk_info, new_chunk.chunk_size, file_id, false, chunks_counted, c);
+                continue;
+            } else if (buffer == NULL) {
+                buffer = malloc(new_chunk.chunk_size);
+                memcpy(buffer, new_chunk.chunk_info, new_chunk.chunk_size);
+            } else {
+                memmove(buffer, new_chunk.chunk_info, new_chunk.chunk_size);
+            }
+            putChunk(buffer, new_chunk.chunk_size, file_id, true, chunks_counted, c);
+        } else {
+            //the counts go to the ones of the chunk, if requested, or to the ones of its file
+            countChunk(&new_chunk, (chunks_counted != NULL) ? chunks_counted->chunks[c].counts : file_counts[file_id], path_bytes,
+                       &compute_time);
+            free(buffer);
+        }
+    }
+
+    return true;
+}
+
+//its role is to get chunks from the FIFO of its process and count the words, in its own counters
+static void *workerThread(void *par) {
+    struct WorkerThread *thread = (struct WorkerThread *) par;
+
+    while (true) {
+        //get chunk of data
+        struct ChunkInfo chunk_info = getChunk(thread->id);
+
+        //checks if it is the chunk that tells that there are no more chunks to process
+        if (chunk_info.file_id == -1) break;
+
+        //the counts of a journaled chunk are stored in its message, which is sent once all its chunks are counted
+        if (chunk_info.counted != NULL) {
+            countChunk(&chunk_info, chunk_info.counted->chunks[chunk_info.index].counts, thread->path_bytes, &thread->compute_time);
+            putCountedChunk(thread->id, chunk_info.counted);
+        } else {
+            countChunk(&chunk_info, thread->file_counts[chunk_info.file_id], thread->path_bytes, &thread->compute_time);
+        }
+
+        //free the memory of the buffer
+        if (chunk_info.owned)
+            free(chunk_info.chunk_info);
+    }
+
+    status_workers[thread->id] = EXIT_SUCCESS;
+    pthread_exit (&status_workers[thread->id]);
+}
+
+//Send messages whose chunks were counted to the dispatcher, to be journaled, and free them
+static void sendCounted(struct CountedMessage *counted) {
+    while (counted != NULL) {
+        struct CountedMessage *next = counted->next;
+        double t = MPI_Wtime();
+        MPI_Send(counted->chunks, counted->num_of_chunks * sizeof(struct CountedChunk), MPI_BYTE, 0, 2, MPI_COMM_WORLD);
+        comm_time += MPI_Wtime() - t;
+        free(counted->chunks);
+        free(counted);
+        counted = next;
+    }
+}
+
+static void openProcessFiles(struct ProcessFiles *process_files, char *file_names[], int num_of_files) {
+    process_files->file_names = file_names;
+    process_files->num_of_files = num_of_files;
+    process_files->files = malloc((num_of_files + 1) * sizeof(MPI_File));
+    process_files->maps = calloc(num_of_files + 1, sizeof(unsigned char *));
+    process_files->map_sizes = calloc(num_of_files + 1, sizeof(size_t));
+    for (int i = 0; i < num_of_files; i++)
+        process_files->files[i] = MPI_FILE_NULL;
+}
+
+static void closeProcessFiles(struct ProcessFiles *process_files) {
+    for (int i = 0; i < process_files->num_of_files; i++) {
+        if (process_files->files[i] != MPI_FILE_NULL)
+            MPI_File_close(&process_files->files[i]);
+        if (process_files->maps[i] != NULL)
+            munmap(process_files->maps[i], process_files->map_sizes[i]);
+    }
+    free(process_files->files);
+    free(process_files->maps);
+    free(process_files->map_sizes);
+}
+
+static unsigned char *mapFile(struct ProcessFiles *process_files, int file_id, size_t file_size) {
+    if (process_files->maps[file_id] != NULL)
+        return process_files->maps[file_id];
+
+    int fd = open(process_files->file_names[file_id], O_RDONLY);
+    if (fd < 0) {
+        printf("It occoured an error while openning file: %s \n", process_files->file_names[file_id]);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    //the mapping stays valid after the file is closed
+    void *map = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    process_files->maps[file_id] = map;
+    process_files->map_sizes[file_id] = file_size;
+    return map;
+}
+
+static void countChunk(struct ChunkInfo * chunk_info, int *counts, long long *path_bytes, double *compute_time) {
+    double t = MPI_Wtime();
+    int total_num_of_words = 0;
+    int total_words_with_two_equal_consonants = 0;
+
+    //process chunk of data
+    if (processChunk(chunk_info, &total_num_of_words, &total_words_with_two_equal_consonants))
+        path_bytes[0] += chunk_info->chunk_size;
+    else
+        path_bytes[1] += chunk_info->chunk_size;
+
+    //the results are only sent at the end
+    counts[0] += total_num_of_words;
+    counts[1] += total_words_with_two_equal_consonants;
+
+    *compute_time += MPI_Wtime() - t;
+}
+
+static unsigned char *readRange(MPI_File file, struct ChunkHeader *range, unsigned char **chunk, int *chunk_size) {
+    uint64_t range_end = range->offset + range->length;
+    int buffer_size = range->length + RANGE_LOOKAHEAD;
+    unsigned char *buffer = NULL;
+    long cut, end;
+    int char_size;
+
+    //read past the end of the range until the safe cut point that ends it is found
+    while (true) {
+        if (range->offset + buffer_size > range->file_size)
+            buffer_size = range->file_size - range->offset;
+
+        buffer = realloc(buffer, buffer_size);
+        MPI_File_read_at(file, range->offset, buffer, buffer_size, MPI_BYTE, MPI_STATUS_IGNORE);
+
+        //the last range ends at the end of the file
+        if (range_end >= range->file_size) {
+            end = buffer_size;
+            break;
+        }
+
+        cut = nextSafeCutInBuffer(buffer, range->length, buffer_size, &char_size);
+        if (char_size > 0 || range->offset + buffer_size >= range->file_size) {
+            end = cut + char_size;
+            break;
+        }
+        buffer_size *= 2;
+    }
+
+    //the range starts at the safe cut point that ends the previous one
+    long start = (range->offset == 0) ? 0 : nextSafeCutInBuffer(buffer, 0, end, &char_size);
+
+    *chunk = buffer + start;
+    *chunk_size = end - start;
+    return buffer;
+}
+
+static bool processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants) {
+    //chunks without bytes above 0x7F don't need the multibyte checks
+    if (is_ascii((*chunk_info).chunk_info, (*chunk_info).chunk_size)) {
+        count_words_ascii((*chunk_info).chunk_info, (*chunk_info).chunk_size, total_num_of_words, total_words_with_two_equal_consonants);
+        return true;
+    }
+
+    processMultibyteChunk(chunk_info, total_num_of_words, total_words_with_two_equal_consonants);
+    return false;
+}
+
+static void processMultibyteChunk(struct ChunkInfo * chunk_info, int * total_num_of_words, int * total_words_with_two_equal_consonants) {
     //flag used to determine if the algorithm is handling the char inside a word context or not
     bool inword = false;  
 
@@ -317,26 +1083,27 @@ static void processChunk(struct ChunkInfo * chunk_info, int * total_num_of_words
         character = malloc((1+1)* sizeof(unsigned char) );      //allocate memory to store the character. For now, it is a single byte
         character[0] = byte;
 
+        //a multibyte char cut by the end of the chunk is completed with 0, so nothing past the chunk is read
         if (byte > 192 && byte < 224) {   //if it is a 2-byte char
             i++;
             character = realloc(character, (2+1)* sizeof(unsigned char) );
-            character[1] = (*chunk_info).chunk_info[i];
+            character[1] = CHUNK_BYTE(chunk_info, i);
             character[2] = 0;
         } else if ( byte > 224 && byte < 240) {     //if it is a 3-byte char
             character = realloc(character, (3+1)* sizeof(unsigned char) );
             i++;
-            character[1] = (*chunk_info).chunk_info[i];
+            character[1] = CHUNK_BYTE(chunk_info, i);
             i++;
-            character[2] = (*chunk_info).chunk_info[i];
+            character[2] = CHUNK_BYTE(chunk_info, i);
             character[3] = 0;
         } else if ( byte > 240 ) {     //if it is a 4-byte char
             character = realloc(character, (4+1)* sizeof(unsigned char) );
             i++;
-            character[1] = (*chunk_info).chunk_info[i];
+            character[1] = CHUNK_BYTE(chunk_info, i);
             i++;
-            character[2] = (*chunk_info).chunk_info[i];
+            character[2] = CHUNK_BYTE(chunk_info, i);
             i++;
-            character[3] = (*chunk_info).chunk_info[i];
+            character[3] = CHUNK_BYTE(chunk_info, i);
             character[4] = 0;
         } else {        //if it is a single byte char
             character[1] = 0;
@@ -1,6 +1,8 @@
 #ifndef COUNTWORDSFUNCTIONS_H
 #define COUNTWORDSFUNCTIONS_H
 
+#include <stdbool.h>
+
 // Function to check if a char is vowel
 extern int is_vowel(unsigned char *c);
 
@@ -28,4 +30,10 @@ extern int is_apostrophe(unsigned char *c);
 // Function to convert multibyte chars to singlebyte chars
 extern char convert_special_chars(unsigned char c);
 
+// Function to check if a buffer has only ASCII bytes (vectorised)
+extern bool is_ascii(unsigned char *buffer, int size);
+
+// Function to count the words of a buffer that has only ASCII bytes
+extern void count_words_ascii(unsigned char *buffer, int size, int *total_num_of_words, int *total_words_with_two_equal_consonants);
+
 #endif /* COUNTWORDSFUNCTIONS_H */
\ No newline at end of file
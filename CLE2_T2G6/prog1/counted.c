@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include "counted.h"
+
+//status of the main thread
+extern int status_main_producer;
+
+//workers threads returns status array
+extern int *status_workers;
+
+//messages whose chunks were all counted, not sent to the dispatcher yet
+static struct CountedMessage *counted_messages;
+
+//locking flag which warrants mutual exclusion inside the monitor
+static pthread_mutex_t accessCM = PTHREAD_MUTEX_INITIALIZER;
+
+//Inform that a chunk of a message was counted, performed by the worker threads
+void putCountedChunk (unsigned int worker_id, struct CountedMessage * message)
+{
+    //entering monitor
+    if ((status_workers[worker_id] = pthread_mutex_lock (&accessCM)) != 0)
+    {
+        errno = status_workers[worker_id];
+        perror ("error on entering monitor(CM)");
+        status_workers[worker_id] = EXIT_FAILURE;
+        pthread_exit (&status_workers[worker_id]);
+    }
+
+    //the last chunk counted moves the message to the list
+    if (++message->num_counted == message->num_of_chunks) {
+        message->next = counted_messages;
+        counted_messages = message;
+    }
+
+    //exiting monitor
+    if ((status_workers[worker_id] = pthread_mutex_unlock (&accessCM)) != 0)
+    {
+        errno = status_workers[worker_id];
+        perror ("error on exiting monitor(CM)");
+        status_workers[worker_id] = EXIT_FAILURE;
+        pthread_exit (&status_workers[worker_id]);
+    }
+}
+
+//Take the messages whose chunks were all counted, performed by the main thread of a worker process
+struct CountedMessage * getCountedMessages (void)
+{
+    struct CountedMessage *messages;
+
+    //entering monitor
+    if ((status_main_producer = pthread_mutex_lock (&accessCM)) != 0)
+    {
+        errno = status_main_producer;
+        perror ("error on entering monitor(CM)");
+        status_main_producer = EXIT_FAILURE;
+        pthread_exit (&status_main_producer);
+    }
+
+    messages = counted_messages;
+    counted_messages = NULL;
+
+    //exiting monitor
+    if ((status_main_producer = pthread_mutex_unlock (&accessCM)) != 0)
+    {
+        errno = status_main_producer;
+        perror ("error on exiting monitor(CM)");
+        status_main_producer = EXIT_FAILURE;
+        pthread_exit (&status_main_producer);
+    }
+
+    return messages;
+}
@@ -0,0 +1,43 @@
+#ifndef COUNTED_H
+#define COUNTED_H
+
+#include <stdint.h>
+
+/** \brief struct to store one counted chunk, as it is sent to the dispatcher to be journaled */
+struct CountedChunk {
+   uint64_t file_id;     /* file identifier */
+   uint64_t offset;      /* Offset of the chunk in the file */
+   uint32_t span;        /* Number of bytes from the offset of the chunk to the offset of the next chunk of the file */
+   int32_t counts[2];    /* Words and words with two equal consonants of the chunk */
+};
+
+/** \brief struct to store the chunks of a message received by a worker, until all of them are counted */
+struct CountedMessage {
+   int num_of_chunks;
+   int num_counted;                /* Number of chunks already counted */
+   struct CountedChunk * chunks;
+   struct CountedMessage * next;   /* Next message whose chunks were all counted */
+};
+
+/**
+ *  \brief Inform that a chunk of a message was counted.
+ *
+ *  Once every chunk of the message is counted, the message is stored in the list of counted messages.
+ *
+ *  Operation carried out by the worker threads, after storing the counts of the chunk in the message.
+ *
+ *  \param worker_id worker thread identification
+ *  \param message message of the chunk
+ */
+extern void putCountedChunk (unsigned int worker_id, struct CountedMessage * message);
+
+/**
+ *  \brief Take the messages whose chunks were all counted.
+ *
+ *  Operation carried out by the main thread of a worker process, which sends them to the dispatcher.
+ *
+ *  \return list of messages linked by next, NULL if there are none
+ */
+extern struct CountedMessage * getCountedMessages (void);
+
+#endif /* COUNTED_H */
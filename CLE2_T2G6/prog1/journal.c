@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "constants.h"
+#include "journal.h"
+
+//identification and version of the journal format
+#define JOURNAL_MAGIC      "CWJL"
+#define JOURNAL_VERSION    2
+
+//suffix of the file where a snapshot is written before it replaces the journal
+#define JOURNAL_TEMP_SUFFIX    ".tmp"
+
+//struct used to store the header of the journal, followed by the size and name of every file
+struct JournalHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t ranges;           //the chunks are nominal byte ranges
+    uint32_t chunk_size;       //nominal number of bytes of a chunk
+    uint32_t num_of_files;
+};
+
+//struct used to store the size and name length of one file in the journal header
+struct JournalFile {
+    uint64_t file_size;
+    uint32_t name_length;
+};
+
+//struct used to store the counts of one file in the journal, followed by its counted spans
+struct JournalCounts {
+    uint64_t words;
+    uint64_t words_with_two_equal_consonants;
+    uint32_t num_of_spans;
+};
+
+//struct used to store a span [start, end) of contiguous counted chunks of a file
+struct JournalSpan {
+    uint64_t start;
+    uint64_t end;
+};
+
+//struct used to store the counted spans of a file, sorted and disjoint, and the counts of their chunks
+struct FileSpans {
+    struct JournalSpan *spans;
+    int num_of_spans;
+    int capacity;
+    long long counts[2];
+};
+
+//name of the journal and of the file where its snapshots are written
+static char *journal_name_, *temp_name;
+
+//files, chunk size and mode of the run, written in the header of every snapshot
+static char **journal_file_names;
+static uint64_t *journal_file_sizes;
+static int journal_num_of_files;
+static bool journal_ranges;
+static int journal_chunk_size;
+
+//spans counted by this run and the previous ones, updated by the dispatcher
+static struct FileSpans *counted;
+
+//spans counted by the run that is being resumed, only read by the reader thread
+static struct FileSpans *resumed;
+
+//time of the last snapshot of the journal
+static struct timespec last_snapshot;
+
+//Write the header of the journal
+static bool writeHeader(FILE *file_pointer) {
+    struct JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, 4);
+    header.version = JOURNAL_VERSION;
+    header.ranges = journal_ranges;
+    header.chunk_size = journal_chunk_size;
+    header.num_of_files = journal_num_of_files;
+    if (fwrite(&header, sizeof(header), 1, file_pointer) != 1) return false;
+
+    for (int i = 0; i < journal_num_of_files; i++) {
+        struct JournalFile file;
+        memset(&file, 0, sizeof(file));
+        file.file_size = journal_file_sizes[i];
+        file.name_length = strlen(journal_file_names[i]);
+        if (fwrite(&file, sizeof(file), 1, file_pointer) != 1 ||
+            fwrite(journal_file_names[i], 1, file.name_length, file_pointer) != file.name_length)
+            return false;
+    }
+    return true;
+}
+
+//Check that the journal was written by a run over the same files, with the same chunks
+static bool checkHeader(FILE *file_pointer) {
+    struct JournalHeader header;
+    if (fread(&header, sizeof(header), 1, file_pointer) != 1 || memcmp(header.magic, JOURNAL_MAGIC, 4) != 0 ||
+        header.version != JOURNAL_VERSION || header.ranges != (uint32_t) journal_ranges ||
+        header.chunk_size != (uint32_t) journal_chunk_size || header.num_of_files != (uint32_t) journal_num_of_files)
+        return false;
+
+    for (int i = 0; i < journal_num_of_files; i++) {
+        struct JournalFile file;
+        char name[strlen(journal_file_names[i]) + 1];
+        if (fread(&file, sizeof(file), 1, file_pointer) != 1 || file.name_length != strlen(journal_file_names[i]) ||
+            fread(name, 1, file.name_length, file_pointer) != file.name_length ||
+            memcmp(name, journal_file_names[i], file.name_length) != 0 || file.file_size != journal_file_sizes[i])
+            return false;
+    }
+    return true;
+}
+
+//Read the counts and spans of every file, returns false if the journal is incomplete
+static bool loadSpans(FILE *file_pointer) {
+    for (int i = 0; i < journal_num_of_files; i++) {
+        struct JournalCounts counts;
+        if (fread(&counts, sizeof(counts), 1, file_pointer) != 1) return false;
+
+        resumed[i].counts[0] = counts.words;
+        resumed[i].counts[1] = counts.words_with_two_equal_consonants;
+        resumed[i].num_of_spans = resumed[i].capacity = counts.num_of_spans;
+        resumed[i].spans = malloc((counts.num_of_spans + 1) * sizeof(struct JournalSpan));
+        if (fread(resumed[i].spans, sizeof(struct JournalSpan), counts.num_of_spans, file_pointer) != counts.num_of_spans)
+            return false;
+    }
+    return true;
+}
+
+//Write a snapshot of the counted spans to a temporary file and replace the journal with it
+static void writeSnapshot(void) {
+    FILE *file_pointer = fopen(temp_name, "wb");
+    bool written = (file_pointer != NULL) && writeHeader(file_pointer);
+
+    for (int i = 0; i < journal_num_of_files && written; i++) {
+        struct JournalCounts counts;
+        memset(&counts, 0, sizeof(counts));
+        counts.words = counted[i].counts[0];
+        counts.words_with_two_equal_consonants = counted[i].counts[1];
+        counts.num_of_spans = counted[i].num_of_spans;
+        written = fwrite(&counts, sizeof(counts), 1, file_pointer) == 1 &&
+                  fwrite(counted[i].spans, sizeof(struct JournalSpan), counted[i].num_of_spans, file_pointer) ==
+                  (size_t) counted[i].num_of_spans;
+    }
+
+    //the snapshot is on disk before it replaces the previous one, so a failure leaves one of them complete
+    if (file_pointer != NULL)
+        written = (fflush(file_pointer) == 0) && (fsync(fileno(file_pointer)) == 0) && (fclose(file_pointer) == 0) && written;
+    if (!written || rename(temp_name, journal_name_) != 0) {
+        perror("error on writing the journal");
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &last_snapshot);
+}
+
+//Index of the first span of a file that ends at or after an offset
+static int firstSpanEnding(struct FileSpans *file, uint64_t offset) {
+    int low = 0, high = file->num_of_spans;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (file->spans[middle].end < offset) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+//Add the span of a counted chunk, merging it with the spans it touches
+static void addSpan(struct FileSpans *file, uint64_t start, uint64_t end) {
+    int i = firstSpanEnding(file, start);
+
+    //the chunk is before every span that is left, or between two of them
+    if (i == file->num_of_spans || file->spans[i].start > end) {
+        if (file->num_of_spans == file->capacity) {
+            file->capacity = (file->capacity == 0) ? 16 : 2 * file->capacity;
+            file->spans = realloc(file->spans, file->capacity * sizeof(struct JournalSpan));
+        }
+        memmove(&file->spans[i + 1], &file->spans[i], (file->num_of_spans - i) * sizeof(struct JournalSpan));
+        file->spans[i].start = start;
+        file->spans[i].end = end;
+        file->num_of_spans++;
+        return;
+    }
+
+    //the chunk extends span i, which may now reach the spans after it
+    if (start < file->spans[i].start) file->spans[i].start = start;
+    if (end > file->spans[i].end) file->spans[i].end = end;
+    int j = i + 1;
+    while (j < file->num_of_spans && file->spans[j].start <= file->spans[i].end) {
+        if (file->spans[j].end > file->spans[i].end) file->spans[i].end = file->spans[j].end;
+        j++;
+    }
+    memmove(&file->spans[i + 1], &file->spans[j], (file->num_of_spans - j) * sizeof(struct JournalSpan));
+    file->num_of_spans -= j - i - 1;
+}
+
+//Open the journal, loading the spans already counted when resuming, performed by the dispatcher
+long long openJournal(char *journal_name, char *file_names[], int num_of_files, bool ranges, int chunk_size, bool resume,
+                      int (*file_counts)[2]) {
+    long long done_bytes = 0;
+
+    journal_name_ = journal_name;
+    temp_name = malloc(strlen(journal_name) + strlen(JOURNAL_TEMP_SUFFIX) + 1);
+    strcpy(temp_name, journal_name);
+    strcat(temp_name, JOURNAL_TEMP_SUFFIX);
+
+    journal_file_names = file_names;
+    journal_num_of_files = num_of_files;
+    journal_ranges = ranges;
+    journal_chunk_size = chunk_size;
+    journal_file_sizes = calloc(num_of_files + 1, sizeof(uint64_t));
+    for (int i = 0; i < num_of_files; i++) {
+        struct stat file_stat;
+        journal_file_sizes[i] = (stat(file_names[i], &file_stat) == 0) ? (uint64_t) file_stat.st_size : 0;
+    }
+
+    counted = calloc(num_of_files + 1, sizeof(struct FileSpans));
+    resumed = calloc(num_of_files + 1, sizeof(struct FileSpans));
+
+    if (resume) {
+        FILE *file_pointer = fopen(journal_name, "rb");
+        if (file_pointer == NULL) {
+            printf("It occoured an error while openning file: %s \n", journal_name);
+            exit(EXIT_FAILURE);
+        }
+        if (!checkHeader(file_pointer) || !loadSpans(file_pointer)) {
+            fprintf(stderr, "The journal %s doesn't match the files, the chunk size or the mode of this run\n", journal_name);
+            exit(EXIT_FAILURE);
+        }
+        fclose(file_pointer);
+
+        //this run goes on from the spans and counts of the previous one
+        for (int i = 0; i < num_of_files; i++) {
+            counted[i] = resumed[i];
+            counted[i].spans = malloc((resumed[i].num_of_spans + 1) * sizeof(struct JournalSpan));
+            memcpy(counted[i].spans, resumed[i].spans, resumed[i].num_of_spans * sizeof(struct JournalSpan));
+            counted[i].capacity = resumed[i].num_of_spans + 1;
+            file_counts[i][0] += resumed[i].counts[0];
+            file_counts[i][1] += resumed[i].counts[1];
+            for (int s = 0; s < resumed[i].num_of_spans; s++)
+                done_bytes += resumed[i].spans[s].end - resumed[i].spans[s].start;
+        }
+    }
+
+    writeSnapshot();
+
+    return done_bytes;
+}
+
+//Check if a chunk was counted by a previous run, performed by the reader thread
+bool isChunkDone(int file_id, long long offset) {
+    if (resumed == NULL) return false;
+
+    //the spans are unions of whole chunks, so a chunk is counted if its offset is in one of them
+    int i = firstSpanEnding(&resumed[file_id], offset + 1);
+    return i < resumed[file_id].num_of_spans && resumed[file_id].spans[i].start <= (uint64_t) offset;
+}
+
+//Add a counted chunk to the journal, performed by the dispatcher
+void journalChunk(int file_id, long long offset, int length, int words, int words_with_two_equal_consonants) {
+    struct timespec now;
+
+    addSpan(&counted[file_id], offset, offset + length);
+    counted[file_id].counts[0] += words;
+    counted[file_id].counts[1] += words_with_two_equal_consonants;
+
+    //the snapshots are written periodically, a failure loses at most the last period
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec - last_snapshot.tv_sec >= JOURNAL_INTERVAL)
+        writeSnapshot();
+}
+
+//Write the last snapshot of the journal, performed by the dispatcher
+void closeJournal(void) {
+    writeSnapshot();
+
+    for (int i = 0; i < journal_num_of_files; i++) {
+        free(counted[i].spans);
+        free(resumed[i].spans);
+    }
+    free(counted);
+    free(resumed);
+    free(journal_file_sizes);
+    free(temp_name);
+    counted = resumed = NULL;
+}
@@ -0,0 +1,64 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+
+/**
+ *  \brief Open the journal of the counted chunks.
+ *
+ *  The journal is a snapshot of the spans of contiguous counted chunks of each file and of their counts.
+ *  Without resume, a new journal is written for the files of this run. With resume, the journal of a previous
+ *  run over the same files (same sizes, chunk size and mode) is read: its counts are added to file_counts,
+ *  the chunks in its spans are reported by isChunkDone, and the new chunks are added to its spans.
+ *
+ *  Operation carried out by the dispatcher.
+ *
+ *  \param journal_name name of the journal file
+ *  \param file_names array with file names
+ *  \param num_of_files number of files
+ *  \param ranges true if the chunks are nominal byte ranges
+ *  \param chunk_size nominal number of bytes of a chunk
+ *  \param resume true to continue the run of the journal
+ *  \param file_counts counters of each file (words and words with two equal consonants)
+ *
+ *  \return number of bytes counted by the previous run
+ */
+extern long long openJournal (char * journal_name, char * file_names[], int num_of_files, bool ranges, int chunk_size, bool resume,
+                              int (* file_counts)[2]);
+
+/**
+ *  \brief Check if a chunk was counted by the run that is being resumed.
+ *
+ *  Operation carried out by the reader thread of the dispatcher.
+ *
+ *  \param file_id file identifier
+ *  \param offset offset of the chunk in the file
+ *
+ *  \return true if the chunk is in a span of the journal
+ */
+extern bool isChunkDone (int file_id, long long offset);
+
+/**
+ *  \brief Add a counted chunk to the spans and counts of the journal.
+ *
+ *  A snapshot of the journal replaces the one on disk every JOURNAL_INTERVAL seconds.
+ *
+ *  Operation carried out by the dispatcher.
+ *
+ *  \param file_id file identifier
+ *  \param offset offset of the chunk in the file
+ *  \param length number of bytes from the offset of the chunk to the offset of the next chunk of the file
+ *  \param words number of words of the chunk
+ *  \param words_with_two_equal_consonants number of words with at least two equal consonants of the chunk
+ */
+extern void journalChunk (int file_id, long long offset, int length, int words, int words_with_two_equal_consonants);
+
+/**
+ *  \brief Write the last snapshot of the journal to disk and close it.
+ *
+ *  Operation carried out by the dispatcher.
+ *
+ */
+extern void closeJournal (void);
+
+#endif /* JOURNAL_H */
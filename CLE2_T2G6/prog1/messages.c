@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include "constants.h"
+#include "messages.h"
+
+//struct used to store one prepared message
+struct MessageInfo {
+   int message_size;
+   unsigned char * message;
+};
+
+//status of the reader thread
+extern int status_reader;
+
+//status of the main thread
+extern int status_main_producer;
+
+//storage region for prepared messages
+static struct MessageInfo mmem[MESSAGES_AHEAD];
+
+static unsigned int insertion_pointer;
+
+static unsigned int retrieval_pointer;
+
+//flag to check if the transfer region is full
+static bool transfer_region_full;
+
+//flag to check if the reader has no more messages to store
+static bool no_more_messages;
+
+//locking flag which warrants mutual exclusion inside the monitor
+static pthread_mutex_t accessMR = PTHREAD_MUTEX_INITIALIZER;
+
+//reader synchronization point when the ring of messages is full
+static pthread_cond_t ring_full = PTHREAD_COND_INITIALIZER;
+
+//main thread synchronization point when the ring of messages is empty
+static pthread_cond_t ring_empty = PTHREAD_COND_INITIALIZER;
+
+//Store a prepared message in the ring, performed by the reader thread
+void putMessage (unsigned char * message, int message_size)
+{
+    //entering monitor
+    if ((status_reader = pthread_mutex_lock (&accessMR)) != 0)
+    {
+        errno = status_reader;
+        perror ("error on entering monitor(MR)");
+        status_reader = EXIT_FAILURE;
+        pthread_exit (&status_reader);
+    }
+
+    //wait if the ring is full
+    while (transfer_region_full)
+    { if ((status_reader = pthread_cond_wait (&ring_full, &accessMR)) != 0)
+        {
+            errno = status_reader;
+            perror ("error on waiting in ringFull");
+            status_reader = EXIT_FAILURE;
+            pthread_exit (&status_reader);
+        }
+    }
+
+    //store values in the ring
+    mmem[insertion_pointer].message = message;
+    mmem[insertion_pointer].message_size = message_size;
+    insertion_pointer = (insertion_pointer + 1) % MESSAGES_AHEAD;
+    transfer_region_full = (insertion_pointer == retrieval_pointer);
+
+    //let the main thread know that a message has been stored
+    if ((status_reader = pthread_cond_signal (&ring_empty)) != 0)
+    {
+        errno = status_reader;
+        perror ("error on signaling in ringEmpty");
+        status_reader = EXIT_FAILURE;
+        pthread_exit (&status_reader);
+    }
+
+    //exiting monitor
+    if ((status_reader = pthread_mutex_unlock (&accessMR)) != 0)
+    {
+        errno = status_reader;
+        perror ("error on exiting monitor(MR)");
+        status_reader = EXIT_FAILURE;
+        pthread_exit (&status_reader);
+    }
+}
+
+//Inform that there are no more messages to be sent, performed by the reader thread
+void endMessages ()
+{
+    //entering monitor
+    if ((status_reader = pthread_mutex_lock (&accessMR)) != 0)
+    {
+        errno = status_reader;
+        perror ("error on entering monitor(MR)");
+        status_reader = EXIT_FAILURE;
+        pthread_exit (&status_reader);
+    }
+
+    no_more_messages = true;
+
+    //let the main thread know that it doesn't have to wait for more messages
+    if ((status_reader = pthread_cond_signal (&ring_empty)) != 0)
+    {
+        errno = status_reader;
+        perror ("error on signaling in ringEmpty");
+        status_reader = EXIT_FAILURE;
+        pthread_exit (&status_reader);
+    }
+
+    //exiting monitor
+    if ((status_reader = pthread_mutex_unlock (&accessMR)) != 0)
+    {
+        errno = status_reader;
+        perror ("error on exiting monitor(MR)");
+        status_reader = EXIT_FAILURE;
+        pthread_exit (&status_reader);
+    }
+}
+
+//Get a prepared message from the ring, performed by the main thread
+bool getMessage (unsigned char ** message, int * message_size)
+{
+    bool has_message;
+
+    //entering monitor
+    if ((status_main_producer = pthread_mutex_lock (&accessMR)) != 0)
+    {
+        errno = status_main_producer;
+        perror ("error on entering monitor(MR)");
+        status_main_producer = EXIT_FAILURE;
+        pthread_exit (&status_main_producer);
+    }
+
+    //wait if the ring is empty and the reader has more messages
+    while ((insertion_pointer == retrieval_pointer) && !transfer_region_full && !no_more_messages)
+    {
+        if ((status_main_producer = pthread_cond_wait (&ring_empty, &accessMR)) != 0)
+        {
+            errno = status_main_producer;
+            perror ("error on waiting in ringEmpty");
+            status_main_producer = EXIT_FAILURE;
+            pthread_exit (&status_main_producer);
+        }
+    }
+
+    //retrieve a message from the ring, if there is one
+    has_message = (insertion_pointer != retrieval_pointer) || transfer_region_full;
+    if (has_message) {
+        *message = mmem[retrieval_pointer].message;
+        *message_size = mmem[retrieval_pointer].message_size;
+        retrieval_pointer = (retrieval_pointer + 1) % MESSAGES_AHEAD;
+        transfer_region_full = false;
+    }
+
+    //let the reader know that a message has been retrieved
+    if ((status_main_producer = pthread_cond_signal (&ring_full)) != 0)
+    {
+        errno = status_main_producer;
+        perror ("error on signaling in ringFull");
+        status_main_producer = EXIT_FAILURE;
+        pthread_exit (&status_main_producer);
+    }
+
+    //exiting monitor
+    if ((status_main_producer = pthread_mutex_unlock (&accessMR)) != 0)
+    {
+        errno = status_main_producer;
+        perror ("error on exiting monitor(MR)");
+        status_main_producer = EXIT_FAILURE;
+        pthread_exit (&status_main_producer);
+    }
+
+    return has_message;
+}
@@ -0,0 +1,36 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <stdbool.h>
+
+/**
+ *  \brief Store a prepared message in the ring of messages to be sent.
+ *
+ *  Operation carried out by the reader thread of the dispatcher, which blocks while the ring is full.
+ *
+ *  \param message pointer to the start of the message
+ *  \param message_size number of bytes of the message
+ */
+extern void putMessage (unsigned char * message, int message_size);
+
+/**
+ *  \brief Inform that there are no more messages to be sent.
+ *
+ *  Operation carried out by the reader thread of the dispatcher.
+ *
+ */
+extern void endMessages ();
+
+/**
+ *  \brief Get the next prepared message from the ring.
+ *
+ *  Operation carried out by the main thread of the dispatcher, which sends the messages.
+ *
+ *  \param message pointer to the start of the message
+ *  \param message_size number of bytes of the message
+ *
+ *  \return false if there are no more messages
+ */
+extern bool getMessage (unsigned char ** message, int * message_size);
+
+#endif /* MESSAGES_H */
@@ -0,0 +1,291 @@
+/**
+ *  \file external.c (implementation file)
+ *
+ *  \brief Problem name: Read integers from one or several binary files and sort them by usninng bitonic sort algorithm and by making use of the MPI library.
+ *
+ *  External sort of the files that don't fit in memory.
+ *
+ *  List of functionns created:
+ *     \li external_sort;
+ *
+ *  \author Tiago Santos and Manuel Diaz - March 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "help_func.h"
+#include "external.h"
+
+// Smallest number of integers of the buffer of a run during the merge
+#define MIN_RUN_BUFFER 1024
+
+// struct used to read a sorted run during the merge
+struct Run {
+    FILE *file;
+    int *buffer;
+    int length;                 // number of integers in the buffer
+    int position;               // next integer of the buffer
+    long remaining;             // number of integers of the run not read yet
+};
+
+/**
+ * \brief Build the name of the temporary file of a run.
+*/
+static void run_name(char *name, size_t name_size, char *output_name, long run) {
+    snprintf(name, name_size, "%s.run%ld", output_name, run);
+}
+
+/**
+ * \brief Read the next integers of a run, returns 0 when the run is over.
+*/
+static int refill_run(struct Run *run, int buffer_size) {
+    if (run->position < run->length) {
+        return 1;
+    }
+    if (run->remaining == 0) {
+        return 0;
+    }
+
+    int to_read = run->remaining < buffer_size ? run->remaining : buffer_size;
+    if (fread(run->buffer, sizeof(int), to_read, run->file) != (size_t) to_read) {
+        fprintf(stderr, "ERROR! Failed to read a run of the external sort.\n");
+        exit(EXIT_FAILURE);
+    }
+    run->length = to_read;
+    run->position = 0;
+    run->remaining -= to_read;
+    return 1;
+}
+
+/**
+ * \brief Check if the next integer of run a is smaller than the next integer of run b, a finished run is never smaller.
+*/
+static int run_less(struct Run *runs, int a, int b) {
+    if (runs[a].position == runs[a].length) {
+        return 0;
+    }
+    if (runs[b].position == runs[b].length) {
+        return 1;
+    }
+    return runs[a].buffer[runs[a].position] < runs[b].buffer[runs[b].position];
+}
+
+/**
+ * \brief Build the subtree of the loser tree under node, storing the loser of each match, returns the winner.
+ *
+ * The leaves of the tree are the nodes num_runs, ..., 2 * num_runs - 1, the internal nodes are 1, ..., num_runs - 1.
+*/
+static int build_tree(int *tree, struct Run *runs, int num_runs, int node) {
+    if (node >= num_runs) {
+        return node - num_runs;
+    }
+    int left = build_tree(tree, runs, num_runs, 2 * node);
+    int right = build_tree(tree, runs, num_runs, 2 * node + 1);
+    if (run_less(runs, left, right)) {
+        tree[node] = right;
+        return left;
+    }
+    tree[node] = left;
+    return right;
+}
+
+/**
+ * \brief Split the file in runs, sort the runs of this processor and write them to temporary files.
+*/
+static int write_runs(FILE *input, char *output_name, int total_n, int run_n, long num_runs, int rank, int size, double *compute_time) {
+    int *run = (int *) malloc(((size_t) run_n + 1) * sizeof(int));
+    char name[strlen(output_name) + 32];
+
+    for (long r = rank; r < num_runs; r += size) {
+        long first = r * run_n;
+        int n = (total_n - first) < run_n ? (int) (total_n - first) : run_n;
+
+        if (fseek(input, (long) sizeof(int) * (1 + first), SEEK_SET) != 0 ||
+            fread(run, sizeof(int), n, input) != (size_t) n) {
+            fprintf(stderr, "ERROR! Failed to read integers from file.\n");
+            free(run);
+            return -1;
+        }
+
+        double t = MPI_Wtime();
+        merge_sort(run, n, 0, 1);
+        *compute_time += MPI_Wtime() - t;
+
+        run_name(name, sizeof(name), output_name, r);
+        FILE *run_file = fopen(name, "wb");
+        if (run_file == NULL || fwrite(run, sizeof(int), n, run_file) != (size_t) n || fclose(run_file) != 0) {
+            fprintf(stderr, "ERROR! Error writing file: %s\n", name);
+            free(run);
+            return -1;
+        }
+    }
+
+    free(run);
+    return 0;
+}
+
+/**
+ * \brief Merge the runs in the output file with a loser tree, returns 1 if the merged integers are sorted and -1 if the output
+ * can't be written.
+*/
+static int merge_runs_to_file(char *output_name, int total_n, int run_n, long num_runs, long memory_budget) {
+    char name[strlen(output_name) + 32];
+    int num_of_runs = num_runs > 0 ? (int) num_runs : 1;
+
+    // the memory budget is shared by the buffers of the runs and the buffer of the output
+    long buffer_size = memory_budget / (long) sizeof(int) / (num_of_runs + 1);
+    if (buffer_size < MIN_RUN_BUFFER) {
+        buffer_size = MIN_RUN_BUFFER;
+    }
+    if (buffer_size > run_n) {
+        buffer_size = run_n;
+    }
+
+    struct Run *runs = (struct Run *) calloc(num_of_runs, sizeof(struct Run));
+    int *tree = (int *) malloc((num_of_runs + 1) * sizeof(int));
+    int *out = (int *) malloc(buffer_size * sizeof(int));
+    int sorted = 1, previous = 0, out_length = 0;
+    long merged = 0;
+
+    // without an output the runs are not merged, but they are still removed
+    FILE *output = fopen(output_name, "wb");
+    if (output == NULL || fwrite(&total_n, sizeof(int), 1, output) != 1) {
+        fprintf(stderr, "ERROR! Error writing file: %s\n", output_name);
+        if (output != NULL) {
+            fclose(output);
+        }
+        sorted = -1;
+    }
+
+    for (long r = 0; r < num_runs && sorted >= 0; r++) {
+        run_name(name, sizeof(name), output_name, r);
+        runs[r].file = fopen(name, "rb");
+        if (runs[r].file == NULL) {
+            fprintf(stderr, "ERROR! Error opening file: %s\n", name);
+            exit(EXIT_FAILURE);
+        }
+        runs[r].buffer = (int *) malloc(buffer_size * sizeof(int));
+        runs[r].remaining = (total_n - r * run_n) < run_n ? (total_n - r * run_n) : run_n;
+        refill_run(&runs[r], buffer_size);
+    }
+
+    if (num_runs > 0 && sorted >= 0) {
+        tree[0] = build_tree(tree, runs, num_of_runs, 1);
+
+        while (merged < total_n) {
+            // the winner is the smallest next integer of all the runs
+            int winner = tree[0];
+            struct Run *run = &runs[winner];
+            int value = run->buffer[run->position++];
+            refill_run(run, buffer_size);
+
+            if (merged > 0 && value < previous) {
+                sorted = 0;
+            }
+            previous = value;
+            merged++;
+
+            out[out_length++] = value;
+            if (out_length == buffer_size) {
+                if (fwrite(out, sizeof(int), out_length, output) != (size_t) out_length) {
+                    fprintf(stderr, "ERROR! Error writing file: %s\n", output_name);
+                    exit(EXIT_FAILURE);
+                }
+                out_length = 0;
+            }
+
+            // replay the matches of the winner from its leaf to the root, the loser stays in each node
+            int s = winner;
+            for (int node = (winner + num_of_runs) / 2; node > 0; node /= 2) {
+                if (run_less(runs, tree[node], s)) {
+                    int temp = tree[node];
+                    tree[node] = s;
+                    s = temp;
+                }
+            }
+            tree[0] = s;
+        }
+    }
+
+    if (sorted >= 0 &&
+        ((out_length > 0 && fwrite(out, sizeof(int), out_length, output) != (size_t) out_length) || fclose(output) != 0)) {
+        fprintf(stderr, "ERROR! Error writing file: %s\n", output_name);
+        exit(EXIT_FAILURE);
+    }
+
+    for (long r = 0; r < num_runs; r++) {
+        if (runs[r].file != NULL) {
+            fclose(runs[r].file);
+        }
+        free(runs[r].buffer);
+        run_name(name, sizeof(name), output_name, r);
+        remove(name);
+    }
+    free(runs);
+    free(tree);
+    free(out);
+
+    return sorted;
+}
+
+/**
+ * \brief Sort a file that may not fit in memory, writing the sorted integers to an output file.
+*/
+int external_sort(char *file_name, char *output_name, long memory_budget, int rank, int size, double *compute_time, double *comm_time) {
+    int total_n = 0;
+    int status = 0;
+
+    // Every processor reads the number of integers and checks the size of the file
+    FILE *input = fopen(file_name, "rb");
+    if (input == NULL) {
+        if (rank == 0) {
+            fprintf(stderr, "ERROR! Error opening file: %s\n", file_name);
+        }
+        status = -1;
+    } else if (fread(&total_n, sizeof(int), 1, input) != 1 || total_n < 0 || fseek(input, 0, SEEK_END) != 0 ||
+               ftell(input) < (long) sizeof(int) * (1 + (long) total_n)) {
+        if (rank == 0) {
+            fprintf(stderr, "ERROR! Unexpected end of file while reading integers.\n");
+        }
+        status = -1;
+    }
+
+    // Runs of a power of 2 integers, the largest that fits in the memory budget, are sorted without extra memory
+    int run_n = 1;
+    while ((long) run_n * 2 * (long) sizeof(int) <= memory_budget && run_n < (1 << 30)) {
+        run_n *= 2;
+    }
+    long num_runs = ((long) total_n + run_n - 1) / run_n;
+
+    if (status == 0) {
+        status = write_runs(input, output_name, total_n, run_n, num_runs, rank, size, compute_time);
+    }
+    if (input != NULL) {
+        fclose(input);
+    }
+
+    // Wait for all the runs to be written
+    double t = MPI_Wtime();
+    MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
+    if (status < 0) {
+        return -1;
+    }
+
+    // Distributor merges the runs
+    int sorted = 1;
+    if (rank == 0) {
+        t = MPI_Wtime();
+        sorted = merge_runs_to_file(output_name, total_n, run_n, num_runs, memory_budget);
+        *compute_time += MPI_Wtime() - t;
+    }
+
+    t = MPI_Wtime();
+    MPI_Bcast(&sorted, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
+
+    return sorted;
+}
@@ -0,0 +1,29 @@
+/**
+ *  \file external.h (interface file)
+ *
+ *  \brief Problem name: Read integers from one or several binary files and sort them by usninng bitonic sort algorithm and by making use of the MPI library.
+ *
+ *  External sort of the files that don't fit in memory.
+ *
+ *  List of functionns created:
+ *     \li external_sort;
+ *
+ *  \author Tiago Santos and Manuel Diaz - March 2024
+ */
+
+#ifndef EXTERNAL_H
+# define EXTERNAL_H
+
+/**
+ * \brief Sort a file that may not fit in memory, writing the sorted integers to an output file.
+ *
+ * The integers are read in runs of at most memory_budget bytes, the runs are distributed among the processors,
+ * sorted with merge_sort and written to temporary files next to the output file. The Distributor then merges all
+ * the runs with a loser tree, in a single pass with large sequential reads and writes, and checks the order of
+ * the merged integers.
+ *
+ * \return 1 if the output is sorted, 0 if it isn't (only meaningful in the Distributor), -1 on an input or output error
+*/
+int external_sort(char *file_name, char *output_name, long memory_budget, int rank, int size, double *compute_time, double *comm_time);
+
+#endif
@@ -9,11 +9,17 @@
  *     \li validate_array;
  *     \li merge_subarrays;
  *     \li merge_sort;
+ *     \li compare_split;
+ *     \li set_sort_threads;
+ *     \li kway_merge;
+ *     \li checksum_array;
  *
  *  \author Tiago Santos and Mannuel Diaz - March 2024
  */
 
+#include <pthread.h>
 
+#include "help_func.h"
 
 /**
  * \brief Validate if array is sorted correctly. 
@@ -27,32 +33,463 @@ int validate_array(int *array, int size) {
     return 1;
 }
 
+// Number of integers of the blocks that are sorted and merged while they are in cache
+#define BLOCK_SIZE 4096
+
+// Number of integers of an AVX2 vector
+#define LANES 8
+
 /**
- * \brief Merge the sub arrays in the sequence. 
+ * \brief Compare and exchange the pairs (i, i + j) for i in [first, first + count), all in the same direction.
 */
-void merge_subarrays(int *array, int n_to_merge, int index, int dir) {
-    if (n_to_merge > 1) {
-        int k = n_to_merge / 2;
-        for (int i = index; i < index + k; i++) {
-            if (dir == (array[i] > array[i + k])) {
-                int temp = array[i];
-                array[i] = array[i + k];
-                array[i + k] = temp;
+static void bitonic_pairs(int *a, int first, int count, int j, int k, int dir) {
+    // every pair of a run of j pairs has the same direction, as k > j
+    int ascending = ((first & k) == 0) == dir;
+    for (int i = first; i < first + count; i++) {
+        int x = a[i], y = a[i + j];
+        int low = x < y ? x : y, high = x < y ? y : x;
+        a[i] = ascending ? low : high;
+        a[i + j] = ascending ? high : low;
+    }
+}
+
+/**
+ * \brief Compare and exchange the pairs (i, i + j) of a[lo..hi), the pairs with (i & k) == 0 in direction dir.
+*/
+static void bitonic_step(int *a, int lo, int hi, int j, int k, int dir) {
+    for (int base = lo; base < hi; base += 2 * j) {
+        bitonic_pairs(a, base, j, j, k, dir);
+    }
+}
+
+/**
+ * \brief Run the steps j = j_first, ..., 1 of stage k over a[lo..hi).
+*/
+static void bitonic_steps(int *a, int lo, int hi, int j_first, int k, int dir) {
+    for (int j = j_first; j > 0; j >>= 1) {
+        bitonic_step(a, lo, hi, j, k, dir);
+    }
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+/**
+ * \brief Compare and exchange the pairs (i, i + j) for i in [first, first + count) with 8-lane min/max, for j >= 8.
+*/
+__attribute__((target("avx2")))
+static void bitonic_pairs_avx2(int *a, int first, int count, int j, int k, int dir) {
+    int ascending = ((first & k) == 0) == dir;
+    for (int i = first; i < first + count; i += LANES) {
+        __m256i x = _mm256_loadu_si256((__m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((__m256i *) (a + i + j));
+        __m256i low = _mm256_min_epi32(x, y), high = _mm256_max_epi32(x, y);
+        _mm256_storeu_si256((__m256i *) (a + i), ascending ? low : high);
+        _mm256_storeu_si256((__m256i *) (a + i + j), ascending ? high : low);
+    }
+}
+
+/**
+ * \brief Compare and exchange the pairs (i, i + j) of a[lo..hi) with 8-lane min/max, for j >= 8.
+*/
+__attribute__((target("avx2")))
+static void bitonic_step_avx2(int *a, int lo, int hi, int j, int k, int dir) {
+    for (int base = lo; base < hi; base += 2 * j) {
+        bitonic_pairs_avx2(a, base, j, j, k, dir);
+    }
+}
+
+/**
+ * \brief Run the steps j = j_first, ..., 1 of the stages k_first, ..., k_last over the 8 integers of a vector, in registers.
+*/
+__attribute__((target("avx2")))
+static __m256i bitonic_vector_avx2(__m256i v, int i, int k_first, int k_last, int j_first, int dir) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i partner[3] = {
+        _mm256_setr_epi32(1, 0, 3, 2, 5, 4, 7, 6),
+        _mm256_setr_epi32(2, 3, 0, 1, 6, 7, 4, 5),
+        _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3)
+    };
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i index = _mm256_add_epi32(_mm256_set1_epi32(i), lane);
+
+    for (int k = k_first; k <= k_last; k <<= 1) {
+        // lanes sorted in ascending order in this stage
+        __m256i ascending = _mm256_cmpeq_epi32(_mm256_and_si256(index, _mm256_set1_epi32(k)), zero);
+        if (!dir) {
+            ascending = _mm256_xor_si256(ascending, _mm256_set1_epi32(-1));
+        }
+
+        for (int j = (k == k_first ? j_first : k >> 1); j > 0; j >>= 1) {
+            __m256i w = _mm256_permutevar8x32_epi32(v, partner[j == 1 ? 0 : j == 2 ? 1 : 2]);
+            __m256i low = _mm256_min_epi32(v, w), high = _mm256_max_epi32(v, w);
+            // the lower lane of a pair takes the minimum in ascending order, the higher lane in descending order
+            __m256i lower = _mm256_cmpeq_epi32(_mm256_and_si256(lane, _mm256_set1_epi32(j)), zero);
+            __m256i take_low = _mm256_cmpeq_epi32(lower, ascending);
+            v = _mm256_blendv_epi8(high, low, take_low);
+        }
+    }
+    return v;
+}
+
+/**
+ * \brief Run the steps j = j_first, ..., 1 of the stages k_first, ..., k_last over a[lo..hi), j_first < 8 and k_last <= 8 or k_first == k_last.
+*/
+__attribute__((target("avx2")))
+static void bitonic_vectors_avx2(int *a, int lo, int hi, int k_first, int k_last, int j_first, int dir) {
+    for (int i = lo; i < hi; i += LANES) {
+        __m256i v = _mm256_loadu_si256((__m256i *) (a + i));
+        v = bitonic_vector_avx2(v, i, k_first, k_last, j_first, dir);
+        _mm256_storeu_si256((__m256i *) (a + i), v);
+    }
+}
+
+/**
+ * \brief Run the steps j = j_first, ..., 1 of stage k over a[lo..hi) with AVX2.
+*/
+__attribute__((target("avx2")))
+static void bitonic_steps_avx2(int *a, int lo, int hi, int j_first, int k, int dir) {
+    int j = j_first;
+    for (; j >= LANES; j >>= 1) {
+        bitonic_step_avx2(a, lo, hi, j, k, dir);
+    }
+    if (j > 0) {
+        bitonic_vectors_avx2(a, lo, hi, k, k, j, dir);
+    }
+}
+
+/**
+ * \brief Check once if the processor supports AVX2.
+*/
+static int has_avx2(void) {
+    static int supported = -1;
+    if (supported < 0) {
+        supported = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return supported;
+}
+#else
+static int has_avx2(void) {
+    return 0;
+}
+#endif
+
+/**
+ * \brief Run the stages k_first, ..., k_last of the bitonic network over a[lo..hi), the first one from step j_first.
+ *
+ * The steps whose pairs are closer than a block are run block by block, so each block is loaded in cache once per
+ * stage instead of once per step.
+*/
+static void bitonic_network(int *a, int lo, int hi, int k_first, int k_last, int j_first, int dir) {
+    int avx2 = has_avx2() && hi - lo >= LANES;
+    int block = hi - lo < BLOCK_SIZE ? hi - lo : BLOCK_SIZE;
+    int k = k_first, j = j_first;
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    // the stages that only pair integers of the same vector are run in registers
+    if (avx2 && k <= LANES) {
+        int k_vector = k_last < LANES ? k_last : LANES;
+        bitonic_vectors_avx2(a, lo, hi, k, k_vector, j, dir);
+        k = 2 * k_vector;
+        j = k >> 1;
+    }
+#endif
+
+    for (; k <= k_last; k <<= 1, j = k >> 1) {
+        // pairs further apart than a block, across the whole range
+        for (; j >= block; j >>= 1) {
+#if defined(__GNUC__) && defined(__x86_64__)
+            if (avx2) {
+                bitonic_step_avx2(a, lo, hi, j, k, dir);
+                continue;
             }
+#endif
+            bitonic_step(a, lo, hi, j, k, dir);
+        }
+
+        // pairs inside a block, block by block
+        for (int b = lo; b < hi && j > 0; b += block) {
+#if defined(__GNUC__) && defined(__x86_64__)
+            if (avx2) {
+                bitonic_steps_avx2(a, b, b + block, j, k, dir);
+                continue;
+            }
+#endif
+            bitonic_steps(a, b, b + block, j, k, dir);
         }
-        merge_subarrays(array, k, index, dir);
-        merge_subarrays(array, k, index + k, dir);
     }
 }
 
 /**
- * \brief Recursively sorts a bitonic sequence.
+ * \brief Sort a[lo..hi) as part of the network of direction dir, sorting the blocks while they are in cache and then merging them.
+*/
+static void sort_range(int *a, int lo, int hi, int dir) {
+    int block = hi - lo < BLOCK_SIZE ? hi - lo : BLOCK_SIZE;
+    for (int b = lo; b < hi; b += block) {
+        bitonic_network(a, b, b + block, 2, block, 1, dir);
+    }
+    if (block < hi - lo) {
+        bitonic_network(a, lo, hi, 2 * block, hi - lo, block, dir);
+    }
+}
+
+// Number of threads used by merge_sort and merge_subarrays
+static int sort_threads = 1;
+
+// struct used to pass the work of one thread of a parallel sort or merge
+struct SortThread {
+    int id;
+    int num_of_threads;
+    int *a;
+    int n;
+    int sort;                   // sort the array, or only merge it when it is a bitonic sequence
+    int dir;
+    pthread_barrier_t *barrier;
+};
+
+/**
+ * \brief Run the network of a parallel sort or merge over the portion of one thread.
+ *
+ * Each thread owns n / num_of_threads consecutive integers. The stages that fit in a portion run without
+ * synchronization; in the steps whose pairs are further apart than a portion, each thread compares its share of
+ * the pairs, and all threads wait for each other before the next step.
+*/
+static void *sort_thread(void *par) {
+    struct SortThread *t = (struct SortThread *) par;
+    int portion = t->n / t->num_of_threads;
+    int lo = t->id * portion, hi = lo + portion;
+    int k = t->n, j = t->n >> 1;
+
+    if (t->sort) {
+        sort_range(t->a, lo, hi, t->dir);
+        k = 2 * portion;
+        j = portion;
+        pthread_barrier_wait(t->barrier);
+    }
+
+    for (; k <= t->n; k <<= 1, j = k >> 1) {
+        for (; j >= portion; j >>= 1) {
+            // the share of this thread of the n / 2 pairs lies in one run of j pairs
+            int m = t->id * (portion / 2);
+            int first = (m / j) * 2 * j + m % j;
+#if defined(__GNUC__) && defined(__x86_64__)
+            if (has_avx2()) {
+                bitonic_pairs_avx2(t->a, first, portion / 2, j, k, t->dir);
+            } else
+#endif
+            bitonic_pairs(t->a, first, portion / 2, j, k, t->dir);
+            pthread_barrier_wait(t->barrier);
+        }
+        bitonic_network(t->a, lo, hi, k, k, j, t->dir);
+        pthread_barrier_wait(t->barrier);
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Sort or merge a[0..n) with the threads, returns 0 when the array is too small to be split.
+*/
+static int parallel_network(int *a, int n, int sort, int dir) {
+    // each thread gets at least a block, and the number of threads is a power of 2
+    int num_of_threads = 1;
+    while (2 * num_of_threads <= sort_threads && n / (2 * num_of_threads) >= BLOCK_SIZE) {
+        num_of_threads *= 2;
+    }
+    if (num_of_threads == 1) {
+        return 0;
+    }
+
+    pthread_t tIdSort[num_of_threads];
+    struct SortThread threads[num_of_threads];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, num_of_threads);
+
+    for (int i = 0; i < num_of_threads; i++) {
+        threads[i] = (struct SortThread) { i, num_of_threads, a, n, sort, dir, &barrier };
+        if (pthread_create(&tIdSort[i], NULL, sort_thread, &threads[i]) != 0) {
+            perror("error on creating sort thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < num_of_threads; i++) {
+        if (pthread_join(tIdSort[i], NULL) != 0) {
+            perror("error on waiting for sort thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_barrier_destroy(&barrier);
+    return 1;
+}
+
+/**
+ * \brief Set the number of threads used to sort and merge.
+*/
+void set_sort_threads(int num_of_threads) {
+    sort_threads = num_of_threads > 0 ? num_of_threads : 1;
+}
+
+/**
+ * \brief Merge the sorted runs a[0..p) and a[p..n) in direction dir, with a buffer for the second run.
+*/
+static void merge_runs(int *a, int p, int n, int dir) {
+    int r = n - p;
+    int *second = (int *) malloc(r * sizeof(int));
+    memcpy(second, a + p, r * sizeof(int));
+
+    // merge from the end, taking the largest integer in ascending order and the smallest in descending order
+    int i = p - 1, j = r - 1;
+    for (int k = n - 1; j >= 0; k--) {
+        if (i >= 0 && (dir ? a[i] > second[j] : a[i] < second[j])) {
+            a[k] = a[i--];
+        } else {
+            a[k] = second[j--];
+        }
+    }
+
+    free(second);
+}
+
+/**
+ * \brief Merge the sub arrays in the sequence.
+*/
+void merge_subarrays(int *array, int n_to_merge, int index, int dir) {
+    if (n_to_merge <= 1) {
+        return;
+    }
+
+    // the network only merges sequences whose length is a power of 2, the others are sorted
+    if ((n_to_merge & (n_to_merge - 1)) != 0) {
+        merge_sort(array, n_to_merge, index, dir);
+        return;
+    }
+
+    // a bitonic sequence is merged by the last stage of the network, where every pair has direction dir
+    if (!parallel_network(array + index, n_to_merge, 0, dir)) {
+        bitonic_network(array + index, 0, n_to_merge, n_to_merge, n_to_merge, n_to_merge >> 1, dir);
+    }
+}
+
+/**
+ * \brief Sorts a sequence by building and merging bitonic sequences.
 */
 void merge_sort(int *array, int size_sub_array, int index, int dir) {
-    if (size_sub_array > 1) {
-        int k = size_sub_array / 2;
-        merge_sort(array, k, index, 1);
-        merge_sort(array, k, index + k, 0);
-        merge_subarrays(array, size_sub_array, index, dir);
+    if (size_sub_array <= 1) {
+        return;
+    }
+
+    // the network only sorts a power of 2 integers: the largest power of 2 and the rest are sorted apart and merged
+    int p = 1;
+    while (p <= size_sub_array / 2) {
+        p *= 2;
+    }
+    if (p < size_sub_array) {
+        merge_sort(array, p, index, dir);
+        merge_sort(array, size_sub_array - p, index + p, dir);
+        merge_runs(array + index, p, size_sub_array, dir);
+        return;
+    }
+
+    if (!parallel_network(array + index, size_sub_array, 1, dir)) {
+        sort_range(array + index, 0, size_sub_array, dir);
+    }
+}
+
+/**
+ * \brief Merge two sorted arrays and keep the lowest or the highest half, sorted in ascending order.
+*/
+void compare_split(int *local, int *remote, int *result, int n, int keep_low) {
+    if (keep_low) {
+        // Merge from the start, keeping the n smallest integers
+        int i = 0, j = 0;
+        for (int k = 0; k < n; k++) {
+            if (local[i] <= remote[j]) {
+                result[k] = local[i++];
+            } else {
+                result[k] = remote[j++];
+            }
+        }
+    } else {
+        // Merge from the end, keeping the n largest integers
+        int i = n - 1, j = n - 1;
+        for (int k = n - 1; k >= 0; k--) {
+            if (local[i] >= remote[j]) {
+                result[k] = local[i--];
+            } else {
+                result[k] = remote[j--];
+            }
+        }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * \brief Restore the heap of runs, ordered by their next integer, from position i.
+*/
+static void sift_down(int *heap, int heap_size, int *input, int *next, int i) {
+    while (1) {
+        int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < heap_size && input[next[heap[left]]] < input[next[heap[smallest]]]) {
+            smallest = left;
+        }
+        if (right < heap_size && input[next[heap[right]]] < input[next[heap[smallest]]]) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        int temp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = temp;
+        i = smallest;
+    }
+}
+
+/**
+ * \brief Merge num_runs sorted runs, run i being input[run_starts[i]..run_starts[i + 1]), in ascending order.
+*/
+void kway_merge(int *input, int *run_starts, int num_runs, int *output) {
+    int *heap = (int *) malloc((num_runs + 1) * sizeof(int));
+    int *next = (int *) malloc((num_runs + 1) * sizeof(int));
+    int heap_size = 0;
+
+    // heap of the runs that are not empty
+    for (int i = 0; i < num_runs; i++) {
+        next[i] = run_starts[i];
+        if (run_starts[i] < run_starts[i + 1]) {
+            heap[heap_size++] = i;
+        }
+    }
+    for (int i = heap_size / 2 - 1; i >= 0; i--) {
+        sift_down(heap, heap_size, input, next, i);
+    }
+
+    // take the smallest next integer until every run is merged
+    int k = 0;
+    while (heap_size > 0) {
+        int run = heap[0];
+        output[k++] = input[next[run]++];
+        if (next[run] == run_starts[run + 1]) {
+            heap[0] = heap[--heap_size];
+        }
+        sift_down(heap, heap_size, input, next, 0);
+    }
+
+    free(heap);
+    free(next);
+}
+
+/**
+ * \brief Checksum of the integers of an array that doesn't depend on their order.
+*/
+uint64_t checksum_array(int *array, int size) {
+    uint64_t checksum = 0;
+    for (int i = 0; i < size; i++) {
+        // the sum of a mix of every integer, so a lost integer isn't compensated by a duplicated one
+        uint64_t x = (uint32_t) array[i] + 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        checksum += x ^ (x >> 31);
+    }
+    return checksum;
+}
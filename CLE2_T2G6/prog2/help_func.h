@@ -9,6 +9,10 @@
  *     \li validate_array;
  *     \li merge_subarrays;
  *     \li merge_sort;
+ *     \li compare_split;
+ *     \li set_sort_threads;
+ *     \li kway_merge;
+ *     \li checksum_array;
  *
  *  \author Tiago Santos and Mannuel Diaz - March 2024
  */
@@ -19,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 
 /**
@@ -36,4 +41,24 @@ void merge_subarrays(int *array, int n_to_merge, int index, int dir) ;
 */
 void merge_sort(int *array, int size_sub_array, int index, int dir);
 
+/**
+ * \brief Merge two sorted arrays and keep the lowest or the highest half, sorted in ascending order.
+*/
+void compare_split(int *local, int *remote, int *result, int n, int keep_low);
+
+/**
+ * \brief Set the number of threads used by merge_sort and merge_subarrays.
+*/
+void set_sort_threads(int num_of_threads);
+
+/**
+ * \brief Merge num_runs sorted runs, run i being input[run_starts[i]..run_starts[i + 1]), in ascending order.
+*/
+void kway_merge(int *input, int *run_starts, int num_runs, int *output);
+
+/**
+ * \brief Checksum of the integers of an array that doesn't depend on their order.
+*/
+uint64_t checksum_array(int *array, int size);
+
 #endif
\ No newline at end of file
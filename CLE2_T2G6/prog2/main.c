@@ -11,11 +11,35 @@
 #include <string.h>
 #include <mpi.h>
 #include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <stdint.h>
 
 #include "help_func.h"
+#include "external.h"
 
+// struct used to store the slice of a file read by this processor
+struct Slice
+{
+    MPI_File file;
+    int total_n;            // number of integers of the file
+    int chunk_size;         // number of integers of every slice, with the padding
+    int num_to_read;        // number of integers of the file in this slice
+    int *local_array;
+    MPI_Request request;    // non-blocking read of the slice
+    const char *error;      // error that stops the file from being sorted, printed with its name when it is processed
+};
 
 static double get_delta_time(void);
+static void print_times(double compute_time, double comm_time, int rank, int size);
+static int start_slice(char *file_name, struct Slice *slice, int rank, int size, double *comm_time);
+static void finish_slice(struct Slice *slice);
+static int sort_slice(struct Slice *slice, int sample, char *output_name, int rank, int size, double *compute_time, double *comm_time);
+static int write_slice(char *output_name, int *local_array, int local_n, long long before, int total_n, int rank, double *comm_time);
+static int validate_slices(int *local_array, int local_n, uint64_t input_checksum, int rank, double *compute_time, double *comm_time);
+static char *output_file_name(char *output_name, int index, int num_of_files);
+static int *bitonic_merge(int *local_array, int chunk_size, int rank, int size, double *compute_time, double *comm_time);
+static int *sample_sort(int *local_array, int local_n, int *result_n, int size, double *compute_time, double *comm_time);
 
 /**
  *  \brief Main function.
@@ -30,152 +54,372 @@ int main(int argc, char *argv[])
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    if (argc < 3 || strcmp(argv[1], "-f") != 0)
+    // Read the options: the files to sort, the number of threads of the local sort, the sort algorithm, the memory
+    // budget of the external sort and the output file
+    char **file_names = (char **)malloc(argc * sizeof(char *));
+    char *output_name = NULL;
+    int num_of_files = 0;
+    int num_of_threads = 1;
+    int sample = 0;
+    long memory_budget = 0;
+    int usage = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:t:sm:o:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                file_names[num_of_files++] = optarg;
+                break;
+            case 's':
+                sample = 1;
+                break;
+            case 'o':
+                output_name = optarg;
+                break;
+            case 'm':
+                if ((memory_budget = atol(optarg) * 1024 * 1024) <= 0) usage = 1;
+                break;
+            case 't':
+                if ((num_of_threads = atoi(optarg)) <= 0) usage = 1;
+                break;
+            default:
+                usage = 1;
+                break;
+        }
+    }
+
+    // The files after the options are also sorted
+    for (int i = optind; i < argc; i++)
+    {
+        file_names[num_of_files++] = argv[i];
+    }
+
+    // The sample sort and the external sort are exclusive, the external sort always writes an output file
+    if (usage || num_of_files == 0 || (sample && memory_budget > 0) || (memory_budget > 0 && output_name == NULL))
     {
         if (rank == 0)
         {
-            fprintf(stderr, "ERROR! Usage: mpiexec -n [number of processors] ./%s -f <file> \n", argv[0]);
+            fprintf(stderr, "ERROR! Usage: mpiexec -n [number of processors] ./%s -f <file> [-f <file> ...] [-t threads per processor] [-s | -m memory budget in MB] [-o <output file>] \n", argv[0]);
         }
+        free(file_names);
         MPI_Finalize();
         return EXIT_FAILURE;
     }
 
+    set_sort_threads(num_of_threads);
+
+    int exit_status = EXIT_SUCCESS;
+    double start_time = MPI_Wtime();
+
+    // The slice of the next file is read while the current one is sorted
+    struct Slice slices[2];
+    double prefetch_time = 0;
+    int next_ready = (memory_budget == 0) && start_slice(file_names[0], &slices[0], rank, size, &prefetch_time);
+
     // Iterate for each file annd sort them
-    //for (int i = 2; i < argc; i++)
-    //{
-        FILE *file = NULL;
-        int total_n = 0; // Total number of integers in the file
+    for (int i = 0; i < num_of_files; i++)
+    {
+        // Time spent by this processor sorting and communicating, the file was opened while the previous one was sorted
+        double compute_time = 0, comm_time = prefetch_time;
+        int sorted;
 
-        // Make Distributor open the file and read the number of integers
         if (rank == 0)
         {
-            file = fopen(argv[2], "rb");
-            if (!file)
+            printf("Current file being processed: %s\n", file_names[i]);
+            //start timer
+            (void) get_delta_time();
+        }
+
+        if (memory_budget > 0)
+        {
+            // External sort: the file is sorted in runs that fit in the memory budget and merged in the output file
+            char *file_output = output_file_name(output_name, i, num_of_files);
+            sorted = external_sort(file_names[i], file_output, memory_budget, rank, size, &compute_time, &comm_time);
+            free(file_output);
+        }
+        else
+        {
+            char *file_output = output_name != NULL ? output_file_name(output_name, i, num_of_files) : NULL;
+            struct Slice *slice = &slices[i % 2];
+            int ready = next_ready;
+            if (ready)
             {
-                fprintf(stderr, "ERROR! Error opening file: %s\n", argv[2]);
-                MPI_Finalize();
-                return EXIT_FAILURE;
+                finish_slice(slice);
             }
-            
-            
-            printf("Current file being processed: %s\n", argv[2]);
-            // Read the number of integers in the file
-
-            size_t items_read = fread(&total_n, sizeof(int), 1, file);
-            if (items_read != 1) {
-                if (feof(file)) {
-                    fprintf(stderr, "ERROR! Unexpected end of file while reading total number of integers.\n");
-                } else if (ferror(file)) {
-                    perror("fread");
-                    fprintf(stderr, "ERROR! Failed to read total number of integers from file.\n");
-                } else {
-                    fprintf(stderr, "ERROR! Failed to read total number of integers from file.\n");
-                }
-                MPI_Finalize();
-                return EXIT_FAILURE;
+            else if (rank == 0)
+            {
+                // The file was opened before the previous one was sorted, its error is reported after its banner
+                fflush(stdout);
+                fprintf(stderr, slice->error, file_names[i]);
             }
 
-       
+            prefetch_time = 0;
+            next_ready = (i + 1 < num_of_files) && start_slice(file_names[i + 1], &slices[(i + 1) % 2], rank, size, &prefetch_time);
 
-            //start timer
-            (void) get_delta_time();
+            sorted = ready ? sort_slice(slice, sample, file_output, rank, size, &compute_time, &comm_time) : -1;
+            free(file_output);
+        }
 
+        if (sorted < 0)
+        {
+            exit_status = EXIT_FAILURE;
+            continue;
         }
 
-        // Broadcast the number of integers to all processors
-        MPI_Bcast(&total_n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (rank == 0)
+        {
+            // Print the execution time
+            printf("Execution time: %f\n", get_delta_time());
+            printf(sorted ? "SUCCESS!\n" : "FAIL!\n");
+        }
 
-        // Allocate memory for the integers
-        int *array = (int *)malloc(total_n * sizeof(int));
+        print_times(compute_time, comm_time, rank, size);
+    }
 
+    if (rank == 0 && num_of_files > 1)
+    {
+        printf("Total execution time: %f\n", MPI_Wtime() - start_time);
+    }
 
-        // Distributor reads all the integers in the file and stores them in the array
-        if (rank == 0)
-        {
-            size_t items_read = fread(array, sizeof(int), total_n, file);
-            if (items_read != total_n) {
-                if (feof(file)) {
-                    fprintf(stderr, "ERROR! Unexpected end of file while reading integers.\n");
-                } else if (ferror(file)) {
-                    perror("fread");
-                    fprintf(stderr, "ERROR! Failed to read integers from file.\n");
-                } else {
-                    fprintf(stderr, "ERROR! Failed to read integers from file.\n");
-                }
-                MPI_Finalize();
-                return EXIT_FAILURE;
-            }
+    free(file_names);
+
+    MPI_Finalize();
+    return exit_status;
+}
+
+/**
+ *  \brief Open a file, read its number of integers and start reading the slice of this processor.
+ *
+ *  The slice is read with a non-blocking MPI-IO read, so it is read while the previous file is sorted.
+ *
+ *  \return 1 if the slice is being read, 0 if the file can't be sorted (the error is stored in the slice)
+ */
+static int start_slice(char *file_name, struct Slice *slice, int rank, int size, double *comm_time)
+{
+    MPI_Offset file_size;
+    double t;
+
+    slice->total_n = 0;
+    slice->error = NULL;
+
+    // Every processor opens the file, to read its own slice of the integers
+    if (MPI_File_open(MPI_COMM_WORLD, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &slice->file) != MPI_SUCCESS)
+    {
+        slice->error = "ERROR! Error opening file: %s\n";
+        return 0;
+    }
 
-            fclose(file);
+    // Make Distributor read the number of integers
+    if (rank == 0)
+    {
+        MPI_Status status;
+        int items_read = 0;
+        if (MPI_File_read_at(slice->file, 0, &slice->total_n, 1, MPI_INT, &status) != MPI_SUCCESS ||
+            MPI_Get_count(&status, MPI_INT, &items_read) != MPI_SUCCESS || items_read != 1)
+        {
+            slice->total_n = -1;
         }
+    }
 
-        // Broadcast the integers to all processors
-        MPI_Bcast(array, total_n, MPI_INT, 0, MPI_COMM_WORLD);
+    // Broadcast the number of integers to all processors
+    t = MPI_Wtime();
+    MPI_Bcast(&slice->total_n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
 
-        // Allocate memory for the local array
-        int *local_array = (int *)malloc(total_n * sizeof(int));
-        
-        //Define chunk size in equal parts for each processor
-        int chunk_size = total_n / size;
+    // Every processor checks that the file has all the integers before reading its slice
+    MPI_File_get_size(slice->file, &file_size);
+    if (slice->total_n < 0 || file_size < (MPI_Offset) (slice->total_n + 1) * (MPI_Offset) sizeof(int))
+    {
+        slice->error = slice->total_n < 0 ? "ERROR! Failed to read total number of integers from file: %s\n"
+                                          : "ERROR! Unexpected end of file while reading integers: %s\n";
+        MPI_File_close(&slice->file);
+        return 0;
+    }
 
-        // Scatter the integers inn chunks to all processors
-        MPI_Scatter(array, chunk_size, MPI_INT, local_array, chunk_size, MPI_INT, 0, MPI_COMM_WORLD);        
+    //Define chunk size in equal parts for each processor, the last slices are padded with the largest integer
+    slice->chunk_size = (slice->total_n + size - 1) / size;
+    slice->num_to_read = slice->total_n - rank * slice->chunk_size;
+    slice->num_to_read = slice->num_to_read < 0 ? 0 : slice->num_to_read > slice->chunk_size ? slice->chunk_size : slice->num_to_read;
 
-        // Use bitonic sort algorithm to sort the integers first array goes in ascending order
-        merge_sort(local_array, chunk_size, 0, 1);
+    // Every processor starts reading its own slice of the integers, after the number of integers
+    slice->local_array = (int *)malloc((slice->chunk_size + 1) * sizeof(int));
+    MPI_Offset offset = (MPI_Offset) (1 + (MPI_Offset) rank * slice->chunk_size) * sizeof(int);
+    MPI_File_iread_at(slice->file, offset, slice->local_array, slice->num_to_read, MPI_INT, &slice->request);
 
-        // Iterate for each processor
-        for (int j = 1; j < size; j <<= 1){
+    return 1;
+}
 
-            // Define the partner processor for the current processor to proceed with the iteration
-            int partner = rank ^ j;
+/**
+ *  \brief Wait for the slice of this processor to be read, close the file and pad the slice.
+ */
+static void finish_slice(struct Slice *slice)
+{
+    MPI_Wait(&slice->request, MPI_STATUS_IGNORE);
+    MPI_File_close(&slice->file);
+    for (int i = slice->num_to_read; i < slice->chunk_size; i++)
+    {
+        slice->local_array[i] = INT_MAX;
+    }
+}
+
+/**
+ *  \brief Sort the slices of a file, write them to the output file and validate the sorted integers.
+ *
+ *  \return 1 if the integers are sorted, 0 if they aren't, -1 if the output can't be written
+ */
+static int sort_slice(struct Slice *slice, int sample, char *output_name, int rank, int size, double *compute_time, double *comm_time)
+{
+    int *local_array = slice->local_array;
+    double t;
+
+    // Checksum of the integers of the file in this slice, compared with the checksum of the sorted integers
+    t = MPI_Wtime();
+    uint64_t input_checksum = checksum_array(local_array, slice->num_to_read);
+    *compute_time += MPI_Wtime() - t;
+
+    // Use bitonic sort algorithm to sort the integers first array goes in ascending order
+    // (the sample sort doesn't need the padding)
+    int local_n = sample ? slice->num_to_read : slice->chunk_size;
+    t = MPI_Wtime();
+    merge_sort(local_array, local_n, 0, 1);
+    *compute_time += MPI_Wtime() - t;
+
+    if (sample)
+    {
+        local_array = sample_sort(local_array, slice->num_to_read, &local_n, size, compute_time, comm_time);
+    }
+    else
+    {
+        local_array = bitonic_merge(local_array, slice->chunk_size, rank, size, compute_time, comm_time);
+    }
 
-            MPI_Sendrecv_replace(local_array, chunk_size, MPI_INT, partner, 0, partner, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    // Number of integers of the lower processors: the padding at the end of the last slices is not part of the file
+    long long before = 0, count = local_n;
+    t = MPI_Wtime();
+    MPI_Exscan(&count, &before, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
+    if (rank == 0)
+    {
+        before = 0;
+    }
+    int sorted_n = before >= slice->total_n ? 0 : (before + local_n > slice->total_n ? (int) (slice->total_n - before) : local_n);
 
-            // Merge the integers in the array with the directions: 0 -> ascending || 1 -> descending
-            if (rank & j){
-                merge_subarrays(local_array, chunk_size, 0, 0);
-            }
-            else
-            {
-                merge_subarrays(local_array, chunk_size, 0, 1);
-            }
-        }
+    // Every processor writes its sorted integers to the output file
+    int written = 1;
+    if (output_name != NULL)
+    {
+        written = write_slice(output_name, local_array, sorted_n, before, slice->total_n, rank, comm_time);
+    }
 
-        MPI_Gather(local_array, chunk_size, MPI_INT, array, chunk_size, MPI_INT, 0, MPI_COMM_WORLD);
+    // Every processor validates its sorted integers
+    int sorted = validate_slices(local_array, sorted_n, input_checksum, rank, compute_time, comm_time);
 
-        // Distributor merge sorts all the local arrays
+    free(local_array);
+
+    return written ? sorted : -1;
+}
+
+/**
+ *  \brief Write the sorted integers of every processor to a file in the format of the input files.
+ *
+ *  The integers of each processor follow the integers of the lower processors, so every processor writes its own
+ *  integers at the offset given by the number of integers of the lower processors, with a collective MPI-IO write.
+ *
+ *  \return 1 if the file was written, 0 otherwise
+ */
+static int write_slice(char *output_name, int *local_array, int local_n, long long before, int total_n, int rank, double *comm_time)
+{
+    MPI_File file;
+    double t = MPI_Wtime();
+
+    if (MPI_File_open(MPI_COMM_WORLD, output_name, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
         if (rank == 0)
         {
-            merge_sort(array, total_n, 0, 1);
-            // Print the execution time
-            printf("Execution time: %f\n", get_delta_time());
-        
-    
-
-            if (validate_array(array, total_n))
-            {
-                printf("SUCCESS!\n");
-                //print the array
-                //for (int i = 0; i < total_n; i++)
-                //{
-                //    printf("%d ", array[i]);
-                //}
-            } 
-            else 
-            {
-                printf("FAIL!\n");
-            }
+            fprintf(stderr, "ERROR! Error opening file: %s\n", output_name);
         }
+        *comm_time += MPI_Wtime() - t;
+        return 0;
+    }
+    MPI_File_set_size(file, (MPI_Offset) (total_n + 1) * (MPI_Offset) sizeof(int));
 
-        free(array);
-        free(local_array);
-    //}
+    // Distributor writes the number of integers
+    if (rank == 0)
+    {
+        MPI_File_write_at(file, 0, &total_n, 1, MPI_INT, MPI_STATUS_IGNORE);
+    }
 
-    
+    MPI_Offset offset = (MPI_Offset) (1 + before) * (MPI_Offset) sizeof(int);
+    int ok = MPI_File_write_at_all(file, offset, local_array, local_n, MPI_INT, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    MPI_File_close(&file);
 
-    MPI_Finalize();
-    return EXIT_SUCCESS;
+    // The file is written only if every processor wrote its integers
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!ok && rank == 0)
+    {
+        fprintf(stderr, "ERROR! Error writing file: %s\n", output_name);
+    }
+
+    *comm_time += MPI_Wtime() - t;
+    return ok;
+}
+
+/**
+ *  \brief Validate the sorted integers of all the processors, without gathering them.
+ *
+ *  Every processor checks the order of its own integers, and that its first integer isn't smaller than the last
+ *  integer of the lower processors, the largest of them being computed with an exclusive scan. The checksums of the
+ *  integers read from the file and of the sorted integers are added over all the processors, so an integer that is
+ *  lost or duplicated is detected.
+ *
+ *  \return 1 if the integers of all the processors are sorted and are the integers of the file, 0 otherwise
+ */
+static int validate_slices(int *local_array, int local_n, uint64_t input_checksum, int rank, double *compute_time, double *comm_time)
+{
+    int last = local_n > 0 ? local_array[local_n - 1] : INT_MIN;
+    int previous_last = INT_MIN;
+    double t;
+
+    t = MPI_Wtime();
+    MPI_Exscan(&last, &previous_last, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
+    if (rank == 0)
+    {
+        previous_last = INT_MIN;
+    }
+
+    // checksum of the file, checksum of the sorted integers and number of processors whose integers aren't in order
+    t = MPI_Wtime();
+    uint64_t values[3] = { input_checksum, checksum_array(local_array, local_n), 0 };
+    if (!validate_array(local_array, local_n) || (local_n > 0 && local_array[0] < previous_last))
+    {
+        values[2] = 1;
+    }
+    *compute_time += MPI_Wtime() - t;
+
+    t = MPI_Wtime();
+    MPI_Allreduce(MPI_IN_PLACE, values, 3, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
+
+    return values[0] == values[1] && values[2] == 0;
+}
+
+/**
+ *  \brief Build the name of the output file of a file, the output name followed by the index of the file when several files are sorted.
+ */
+static char *output_file_name(char *output_name, int index, int num_of_files)
+{
+    char *name = (char *)malloc(strlen(output_name) + 16);
+    if (num_of_files == 1)
+    {
+        strcpy(name, output_name);
+    }
+    else
+    {
+        sprintf(name, "%s.%d", output_name, index);
+    }
+    return name;
 }
 
 /**
@@ -195,3 +439,183 @@ static double get_delta_time(void)
 	}
 	return (double) (t1.tv_sec - t0.tv_sec) + 1.0e-9 * (double) (t1.tv_nsec - t0.tv_nsec);
 }
+
+/**
+ *  \brief Gather the time each processor spent sorting and communicating, and print it in the Distributor.
+ */
+static void print_times(double compute_time, double comm_time, int rank, int size)
+{
+    double times[2] = { compute_time, comm_time };
+    double *all_times = (double *)malloc(2 * size * sizeof(double));
+    MPI_Gather(times, 2, MPI_DOUBLE, all_times, 2, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (rank == 0)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            printf("Rank %d: compute %.6f s, communication %.6f s\n", i, all_times[2*i], all_times[2*i+1]);
+        }
+    }
+    free(all_times);
+}
+
+/**
+ *  \brief Merge the sorted slices of the processors with a bitonic network of compare-splits.
+ *
+ *  In stage k the groups of k processors are merged by a compare-split with the mirrored processor of the group,
+ *  and then with the partners at distance k/4, ..., 1. The lower processor of a pair always keeps the lower half.
+ *  When the number of processors is not a power of 2, the network has virtual processors above size that only hold
+ *  the largest integer: they never get an integer of the file, so the pairs with a virtual processor are skipped.
+ *
+ *  \return the sorted slice of this processor, chunk_size integers
+ */
+static int *bitonic_merge(int *local_array, int chunk_size, int rank, int size, double *compute_time, double *comm_time)
+{
+    double t;
+
+    // Buffers for the slice of the partner and for the result of each compare-split
+    int *remote_array = (int *)malloc(chunk_size * sizeof(int));
+    int *merged_array = (int *)malloc(chunk_size * sizeof(int));
+
+    // Number of processors of the network, a power of 2
+    int network_size = 1;
+    while (network_size < size)
+    {
+        network_size <<= 1;
+    }
+
+    for (int k = 2; k <= network_size; k <<= 1)
+    {
+        for (int j = k >> 1; j > 0; j >>= 1)
+        {
+            // Define the partner processor for the current processor to proceed with the iteration
+            int partner = (j == k >> 1) ? rank ^ (k - 1) : rank ^ j;
+            if (partner >= size)
+            {
+                continue;
+            }
+
+            t = MPI_Wtime();
+            MPI_Sendrecv(local_array, chunk_size, MPI_INT, partner, 0, remote_array, chunk_size, MPI_INT, partner, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            *comm_time += MPI_Wtime() - t;
+
+            t = MPI_Wtime();
+            compare_split(local_array, remote_array, merged_array, chunk_size, rank < partner);
+            int *temp = local_array;
+            local_array = merged_array;
+            merged_array = temp;
+            *compute_time += MPI_Wtime() - t;
+        }
+    }
+
+    free(remote_array);
+    free(merged_array);
+
+    return local_array;
+}
+
+/**
+ *  \brief Redistribute the sorted slices of the processors by value ranges, with regular sampling.
+ *
+ *  Every processor takes size samples at regular positions of its sorted slice, and the size - 1 splitters are
+ *  taken at regular positions of all the sorted samples. Every processor sends to processor i the integers between
+ *  splitters i - 1 and i with a single all-to-all exchange, and merges the sorted runs it receives.
+ *
+ *  \return the sorted integers of this processor, result_n integers
+ */
+static int *sample_sort(int *local_array, int local_n, int *result_n, int size, double *compute_time, double *comm_time)
+{
+    double t;
+    int num_samples = local_n < size ? local_n : size;
+    int *samples = (int *)malloc((num_samples + 1) * sizeof(int));
+    int *sample_counts = (int *)malloc(size * sizeof(int));
+    int *sample_displs = (int *)malloc(size * sizeof(int));
+
+    // Regular samples of the sorted slice
+    for (int i = 0; i < num_samples; i++)
+    {
+        samples[i] = local_array[(long) i * local_n / num_samples];
+    }
+
+    t = MPI_Wtime();
+    MPI_Allgather(&num_samples, 1, MPI_INT, sample_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    int total_samples = 0;
+    for (int i = 0; i < size; i++)
+    {
+        sample_displs[i] = total_samples;
+        total_samples += sample_counts[i];
+    }
+    int *all_samples = (int *)malloc((total_samples + 1) * sizeof(int));
+    MPI_Allgatherv(samples, num_samples, MPI_INT, all_samples, sample_counts, sample_displs, MPI_INT, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
+
+    t = MPI_Wtime();
+    merge_sort(all_samples, total_samples, 0, 1);
+
+    // Integers sent to each processor: processor i gets the integers up to splitter i, after splitter i - 1
+    int *send_counts = (int *)malloc(size * sizeof(int));
+    int *send_displs = (int *)malloc(size * sizeof(int));
+    int start = 0;
+    for (int i = 0; i < size; i++)
+    {
+        int end = local_n;
+        if (i < size - 1 && total_samples > 0)
+        {
+            int splitter = all_samples[(long) (i + 1) * total_samples / size];
+            // first integer of the slice greater than the splitter
+            int lo = start, hi = local_n;
+            while (lo < hi)
+            {
+                int mid = lo + (hi - lo) / 2;
+                if (local_array[mid] <= splitter)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            end = lo;
+        }
+        send_displs[i] = start;
+        send_counts[i] = end - start;
+        start = end;
+    }
+    *compute_time += MPI_Wtime() - t;
+
+    // Exchange the integers
+    int *recv_counts = (int *)malloc(size * sizeof(int));
+    int *recv_displs = (int *)malloc((size + 1) * sizeof(int));
+
+    t = MPI_Wtime();
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    *result_n = 0;
+    for (int i = 0; i < size; i++)
+    {
+        recv_displs[i] = *result_n;
+        *result_n += recv_counts[i];
+    }
+    recv_displs[size] = *result_n;
+    int *received = (int *)malloc((*result_n + 1) * sizeof(int));
+    MPI_Alltoallv(local_array, send_counts, send_displs, MPI_INT, received, recv_counts, recv_displs, MPI_INT, MPI_COMM_WORLD);
+    *comm_time += MPI_Wtime() - t;
+
+    // Merge the sorted runs received from every processor
+    t = MPI_Wtime();
+    int *result = (int *)malloc((*result_n + 1) * sizeof(int));
+    kway_merge(received, recv_displs, size, result);
+    *compute_time += MPI_Wtime() - t;
+
+    free(samples);
+    free(sample_counts);
+    free(sample_displs);
+    free(all_samples);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    free(received);
+    free(local_array);
+
+    return result;
+}